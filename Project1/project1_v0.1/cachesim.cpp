@@ -1,32 +1,14 @@
 #include "cachesim.hpp"
-#include <cmath>
-#include <iostream>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
 using namespace std;
-//declaring the LRU counter to keep track of the LRU block
-int time_counter;
 
-//declaring functions used in the program
-unsigned createMask(unsigned, unsigned);
-void setValues(int, int, long, int);
+//size of the bitstream log buffer
+static const size_t LOG_BITS_BYTES = 1 << 16;
 
-//the cache block is declared as a struct object with 
-//required components
-struct cache_block {
-	int dirty_bit;
-	int valid_bit;
-	long tag;
-	long LRUNum;
-};
-
-//declaring variables to measure hit/miss statistics
-uint64_t accesses, reads, writes, read_hits_l1, write_hits_l1, total_hits_l1, read_misses_l1, write_misses_l1, total_misses_l1, write_back_l1;
-
-//the cache is a double pointer to the struct object (essentially a matrix of struct objects)
-//Each pointer is a way pointing to the sets in that way
-struct cache_block ** cache;
-
-//declaring global variables to keep track of the different bits of the address 
-int blocksize_bits, tag_bits, set_bits, way_num, num_sets, S;
+//the default instance behind the C interface
+static Cache* default_cache;
 
 /**
  * Subroutine for initializing the cache. You many add and initialize any global or heap
@@ -36,35 +18,11 @@ int blocksize_bits, tag_bits, set_bits, way_num, num_sets, S;
  * @c1 The total number of bytes for data storage in L1 is 2^c
  * @b1 The size of L1's blocks in bytes: 2^b-byte blocks.
  * @s1 The number of blocks in each set of L1: 2^s blocks per set.
+ * @policy The replacement policy, LRU unless -r selects another
  */
-void setup_cache(uint64_t c1, uint64_t b1, uint64_t s1) {
-	int cachesize = pow(2, c1);
-	int blocksize = pow(2, b1);
-	//finding the number of blocks, number of sets, and number of ways in each set
-	int num_blocks = cachesize / blocksize;
-	way_num = pow(2, s1);
-	S = s1;
-	num_sets = num_blocks / way_num;
-	//allocate memory for each way
-	cache = new cache_block *[way_num];
-	int i;
-	for (i = 0; i < way_num; i++) {
-		//allocate memory for each set in a way
-		cache[i] = new cache_block[num_sets];
-		int j;
-		for (j = 0; j < num_sets; j++) {
-			//initializing the struct object fields for a cold start
-			cache[i][j].dirty_bit = 0;
-			cache[i][j].valid_bit = 0;
-			cache[i][j].tag = 0;
-			cache[i][j].LRUNum = 0;
-		}
-	}
-
-	blocksize_bits = b1;
-	set_bits = log2(num_sets);
-	//initializing the LRU counter
-	time_counter = 0;
+void setup_cache(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy) {
+	delete default_cache;
+	default_cache = new Cache(c1, b1, s1, policy);
 }
 
 /**
@@ -76,175 +34,706 @@ void setup_cache(uint64_t c1, uint64_t b1, uint64_t s1) {
  * @p_stats Pointer to the statistics structure
  */
 void cache_access(char type, uint64_t arg, cache_stats_t* p_stats) {
-	//increment accesses every time this function is called
-	accesses++;
-	//extract the required bits from the address and calculated the set number and tag
-	int total_bits = floor(log2(arg)) + 1;
-	tag_bits = total_bits - (blocksize_bits + set_bits);
-	int set_num;
-	long tag_value;
-	if (tag_bits != total_bits) {
-		set_num = (createMask(blocksize_bits, blocksize_bits + set_bits - 1) & arg) >> blocksize_bits;
-		tag_value = (createMask(blocksize_bits + set_bits, total_bits - 1) & arg) >> (blocksize_bits + set_bits);
+	default_cache->access(type, arg);
+}
+
+/**
+ * Subroutine for cleaning up any outstanding memory operations and calculating overall statistics
+ * such as miss rate or average access time.
+ * XXX: You're responsible for completing this routine
+ *
+ * @p_stats Pointer to the statistics structure
+ */
+void complete_cache(cache_stats_t *p_stats) {
+	default_cache->complete(p_stats);
+	delete default_cache;
+	default_cache = NULL;
+}
+
+/**
+ * Subroutine for turning on a prefetcher in front of cache_access
+ *
+ * @p_config Kind, degree and distance of the prefetcher
+ */
+void set_prefetcher(const prefetch_config_t* p_config) {
+	default_cache->set_prefetcher(p_config);
+}
+
+/**
+ * Subroutine for selecting the write policies of cache_access
+ *
+ * @p_config Write hit and miss policies and the write-combining buffer
+ */
+void set_write_config(const write_config_t* p_config) {
+	default_cache->set_write_config(p_config);
+}
+
+/**
+ * Subroutine for logging the statistics of cache_access every interval accesses
+ *
+ * @interval The number of accesses per record
+ * @out The csv stream the records are written to
+ */
+void set_interval_log(uint64_t interval, FILE* out) {
+	default_cache->set_interval_log(interval, out);
+}
+
+/**
+ * Subroutine for selecting where cache_access reports hits and misses
+ *
+ * @mode LOG_NONE, LOG_TEXT or LOG_BITS
+ * @out The stream the log is written to
+ */
+void set_hitmiss_log(hitmiss_log_t mode, FILE* out) {
+	default_cache->set_hitmiss_log(mode, out);
+}
+
+/**
+ * Sets up a cold cache
+ *
+ * @c1 The total number of bytes for data storage is 2^c
+ * @b1 The size of the blocks in bytes: 2^b-byte blocks.
+ * @s1 The number of blocks in each set: 2^s blocks per set.
+ * @policy The replacement policy
+ */
+Cache::Cache(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy) {
+	//finding the number of sets and number of ways in each set
+	set_bits = c1 - b1 - s1;
+	way_num = 1 << s1;
+	S = s1;
+	num_sets = (uint64_t) 1 << set_bits;
+	//allocate the tag and state arrays in one cache-line aligned block
+	//and zero it for a cold start (every block invalid and clean)
+	uint64_t num_blocks = num_sets * way_num;
+	size_t bytes = num_blocks * (sizeof(uint64_t) + sizeof(uint8_t)) + WAY_SEARCH_STATE_PAD;
+	if (posix_memalign(&storage, 64, bytes) != 0)
+		abort();
+	memset(storage, 0, bytes);
+	tags = (uint64_t*) storage;
+	block_state = (uint8_t*) (tags + num_blocks);
+	way_search = select_way_search(way_num);
+	this->policy = policy;
+	replacement_init(&repl, policy, set_bits, s1);
+
+	//the block offset is the lowest b1 bits, followed by the set index,
+	//the tag is everything above the index
+	index_shift = b1;
+	index_mask = num_sets - 1;
+	tag_shift = b1 + set_bits;
+	//initializing the statistics
+	memset(&stats, 0, sizeof(stats));
+
+	log_mode = LOG_NONE;
+	log_out = NULL;
+	log_bits = NULL;
+	log_bit_count = 0;
+
+	prefetcher = NULL;
+	prefetch_time = NULL;
+	pollution_filter = NULL;
+	num_prefetch_fills = 0;
+
+	write_through = false;
+	write_allocate = true;
+	write_buffer = NULL;
+
+	interval = 0;
+	interval_end = UINT64_MAX;
+	interval_out = NULL;
+}
+
+Cache::~Cache() {
+	free(storage);
+	replacement_free(&repl);
+	delete[] log_bits;
+	delete prefetcher;
+	delete[] prefetch_time;
+	delete[] pollution_filter;
+	delete write_buffer;
+}
+
+/**
+ * Selects where access reports hits and misses
+ *
+ * @mode LOG_NONE, LOG_TEXT or LOG_BITS
+ * @out The stream the log is written to
+ */
+void Cache::set_hitmiss_log(hitmiss_log_t mode, FILE* out) {
+	log_mode = mode;
+	log_out = out;
+	log_bit_count = 0;
+	if (mode == LOG_BITS && log_bits == NULL)
+		log_bits = new unsigned char[LOG_BITS_BYTES]();
+}
+
+/**
+ * Turns on a prefetcher
+ *
+ * @p_config Kind, degree and distance of the prefetcher
+ */
+void Cache::set_prefetcher(const prefetch_config_t* p_config) {
+	if (p_config->kind == PREFETCH_NONE || prefetcher != NULL)
+		return;
+	uint64_t num_blocks = num_sets * way_num;
+	prefetcher = new Prefetcher(*p_config, index_shift);
+	prefetch_time = new uint64_t[num_blocks]();
+	pollution_filter = new uint64_t[num_blocks]();
+}
+
+/**
+ * Selects how writes reach the next level
+ *
+ * @p_config Write hit and miss policies and the write-combining buffer
+ */
+void Cache::set_write_config(const write_config_t* p_config) {
+	write_through = p_config->write_through;
+	write_allocate = p_config->write_allocate;
+	delete write_buffer;
+	write_buffer = NULL;
+	if (p_config->buffer_entries > 0)
+		write_buffer = new WriteBuffer(p_config->buffer_entries, p_config->drain_interval);
+}
+
+/**
+ * Starts the interval log
+ *
+ * @interval The number of accesses per record
+ * @out The csv stream the records are written to
+ */
+void Cache::set_interval_log(uint64_t interval, FILE* out) {
+	this->interval = interval;
+	interval_end = stats.accesses + interval;
+	interval_out = out;
+	interval_start = stats;
+	fputs("first_access,accesses,misses,write_backs,miss_ratio\n", interval_out);
+}
+
+/**
+ * Writes the record of the interval ending with the last access and starts the next
+ */
+void Cache::log_interval() {
+	uint64_t accesses = stats.accesses - interval_start.accesses;
+	uint64_t misses = stats.total_misses_l1 - interval_start.total_misses_l1;
+	if (accesses > 0) {
+		fprintf(interval_out, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.4f\n", interval_start.accesses,
+		        accesses, misses, stats.write_back_l1 - interval_start.write_back_l1, misses / (double) accesses);
 	}
-	else {
-		//if c,b,s are all zeros, there is only one block in the entire cache
-		tag_value = arg;
-		set_num = 0;
+	interval_start = stats;
+	interval_end = stats.accesses + interval;
+}
+
+/**
+ * Sends one block write to the next level, through the write-combining
+ * buffer if there is one
+ *
+ * @block_num The block number, the address without the block offset
+ */
+inline void Cache::write_next(uint64_t block_num) {
+	if (write_buffer == NULL)
+		stats.next_level_writes++;
+	else
+		stats.next_level_writes += write_buffer->write(block_num, stats.accesses);
+}
+
+/**
+ * Writes out the bitstream buffer, the last byte is padded with zeros
+ */
+void Cache::flush_log_bits() {
+	fwrite(log_bits, 1, (log_bit_count + 7) / 8, log_out);
+	memset(log_bits, 0, LOG_BITS_BYTES);
+	log_bit_count = 0;
+}
+
+/**
+ * Logs the outcome of one access
+ *
+ * @hit whether the access hit
+ */
+inline void Cache::log_access(bool hit) {
+	if (log_mode == LOG_NONE)
+		return;
+	if (log_mode == LOG_TEXT) {
+		fputs(hit ? "H\n" : "M\n", log_out);
+		return;
+	}
+	log_bits[log_bit_count / 8] |= (unsigned char) hit << (log_bit_count % 8);
+	if (++log_bit_count == 8 * LOG_BITS_BYTES)
+		flush_log_bits();
+}
+
+/**
+ * Simulates the cache one trace event at a time
+ *
+ * @type The type of event, can be READ or WRITE.
+ * @arg  The target memory address
+ */
+void Cache::access(char type, uint64_t arg) {
+	cache_victim_t victim;
+	//the default policy is instantiated here too, saving a call per access
+	if (policy == REPL_LRU)
+		lookup_fill<lru_policy>(type, arg, &victim);
+	else
+		access(type, arg, &victim);
+}
+
+/**
+ * Simulates one trace event and reports the block it evicted
+ *
+ * @type The type of event, can be READ or WRITE.
+ * @arg  The target memory address
+ * @p_victim Set to the evicted block, valid is false if nothing was evicted
+ */
+bool Cache::access(char type, uint64_t arg, cache_victim_t* p_victim) {
+	switch (policy) {
+	case REPL_TREE_PLRU:
+		return lookup_fill<tree_plru_policy>(type, arg, p_victim);
+	case REPL_BIT_PLRU:
+		return lookup_fill<bit_plru_policy>(type, arg, p_victim);
+	case REPL_SRRIP:
+		return lookup_fill<srrip_policy>(type, arg, p_victim);
+	case REPL_BRRIP:
+		return lookup_fill<brrip_policy>(type, arg, p_victim);
+	case REPL_FIFO:
+		return lookup_fill<fifo_policy>(type, arg, p_victim);
+	case REPL_RANDOM:
+		return lookup_fill<random_policy>(type, arg, p_victim);
+	case REPL_LFU:
+		return lookup_fill<lfu_policy>(type, arg, p_victim);
+	case REPL_OPT:
+		return lookup_fill<opt_policy>(type, arg, p_victim);
+	default:
+		return lookup_fill<lru_policy>(type, arg, p_victim);
 	}
+}
+
+/**
+ * The body of access: looks the block up, updates the replacement and dirty
+ * state on a hit and brings the block in on a miss. Writes follow the write
+ * policies, write-back and write-allocate by default.
+ */
+template <class P>
+__attribute__((always_inline)) inline bool Cache::lookup_fill(char type, uint64_t arg, cache_victim_t* p_victim) {
+	//the previous access closed an interval
+	if (__builtin_expect(stats.accesses == interval_end, 0))
+		log_interval();
+	//increment accesses every time this function is called
+	stats.accesses++;
+	//extract the set number and tag from the address
+	uint64_t set_num = (arg >> index_shift) & index_mask;
+	uint64_t tag_value = arg >> tag_shift;
 	//increment reads or writes based on access type
 	if (type == 'r')
-		reads++;
+		stats.reads++;
 	else
-		writes++;
+		stats.writes++;
 	
-	bool hit = false;
-	struct cache_block* curr_set;
-	int i;
-	//loop through all the blocks in a set to check a hit
-	for (i = 0; i < way_num; i++) {
-		curr_set = &cache[i][set_num];
-
-		if (curr_set->tag == tag_value && curr_set->valid_bit == 1) {
-			//There is a hit
-			hit = true;
-			break;
-		}
-	}
+	//pointers to the ways of the set being accessed
+	uint64_t base = set_num * way_num;
+	uint64_t* set_tags = tags + base;
+	uint8_t* set_state = block_state + base;
 
-	if (hit) {
-		//increase hit counters, set the LRU value and set dirty bit if required
-		cout << "H" << endl;
-		curr_set->LRUNum = time_counter;
-		time_counter++;
-		total_hits_l1++;
+	//search all the blocks in a set to check a hit
+	int i = way_search.vectorized ? way_search.find_tag(set_tags, set_state, way_num, tag_value)
+	                              : find_tag_scalar(set_tags, set_state, way_num, tag_value);
+
+	p_victim->valid = false;
+	if (i >= 0) {
+		//increase hit counters, update the replacement state and set dirty bit if required
+		log_access(true);
+		P::touch(&repl, set_num, i);
+		bool first_use = false;
+		if (set_state[i] & BLOCK_PREFETCHED) {
+			//the first demand use of a prefetched block
+			first_use = true;
+			set_state[i] &= ~BLOCK_PREFETCHED;
+			stats.prefetch_useful++;
+			uint64_t elapsed = stats.accesses - prefetch_time[base + i];
+			if (elapsed <= PREFETCH_LATENCY) {
+				stats.prefetch_late++;
+				stats.prefetch_late_cycles += PREFETCH_LATENCY - elapsed;
+			}
+		}
+		stats.total_hits_l1++;
 		if (type == 'r')
-			read_hits_l1++;
+			stats.read_hits_l1++;
 		else
-			write_hits_l1++;
+			stats.write_hits_l1++;
 
-		if (type == 'w' && curr_set->dirty_bit == 0)
-			curr_set->dirty_bit = 1;
+		if (type == 'w') {
+			if (write_through)
+				write_next(arg >> index_shift);
+			else
+				set_state[i] |= BLOCK_DIRTY;
+		}
+		if (prefetcher != NULL)
+			prefetch<P>(arg, false, first_use);
+		return true;
 	}
-	else {
-		//Miss
-		cout << "M" << endl;
-		//increment miss counters
-		total_misses_l1++;
-		if (type == 'r')
-			read_misses_l1++;
+
+	//Miss
+	log_access(false);
+	//increment miss counters
+	stats.total_misses_l1++;
+	if (type == 'r')
+		stats.read_misses_l1++;
+	else
+		stats.write_misses_l1++;
+
+	int dirty = 0;
+	if (type == 'w') {
+		if (write_through || !write_allocate)
+			write_next(arg >> index_shift);
 		else
-			write_misses_l1++;
-
-		bool block_empty = false;
-		int i;
-		//loop through blocks to find if there is an empty block
-		for (i = 0; i < way_num; i++) {
-			if (cache[i][set_num].valid_bit == 0) {
-				//empty block found
-				block_empty = true;
-				break;
-			}
+			dirty = 1;
+	}
+	if (type != 'w' || write_allocate) {
+		fill<P>(set_num, tag_value, dirty, p_victim);
+		//increase write backs only when a block is evicted and is dirty
+		if (p_victim->valid && p_victim->dirty) {
+			stats.write_back_l1++;
+			write_next(p_victim->address >> index_shift);
 		}
-
-		if (block_empty) {
-			//bring in the required block and set the struct fields
-			int dirty = 0;
-			if (type == 'w')
-				dirty = 1;
-			setValues(i, set_num, tag_value, dirty);
+	}
+	if (prefetcher != NULL) {
+		//a miss to a block that a prefetch pushed out
+		uint64_t block_num = arg >> index_shift;
+		uint64_t* evicted = &pollution_filter[block_num & (num_sets * way_num - 1)];
+		if (*evicted == block_num + 1) {
+			stats.prefetch_pollution++;
+			*evicted = 0;
 		}
-		else {
-			//set is full, need to find a victim
-			//LRU replacement policy used
-			long smallest_LRUNum = cache[0][set_num].LRUNum;
-			int evict_num = 0;
-			int i;
-			//find block with smallest LRUNum to evict it
-			for (i = 0; i < way_num; i++) {
-				if (cache[i][set_num].LRUNum < smallest_LRUNum) {
-					smallest_LRUNum = cache[i][set_num].LRUNum;
-					evict_num = i;
-				}
-			}
+		prefetch<P>(arg, true, false);
+	}
+	return false;
+}
 
-			//increase write backs only when a block is evicted and is dirty
-			if (cache[evict_num][set_num].dirty_bit == 1)
-				write_back_l1++;
+/**
+ * Trains the prefetcher on a demand access and brings in the blocks it asks for
+ *
+ * @arg  The target memory address
+ * @miss The access missed
+ * @first_use The access hit a prefetched block for the first time
+ */
+template <class P>
+void Cache::prefetch(uint64_t arg, bool miss, bool first_use) {
+	uint64_t blocks[PREFETCH_MAX_DEGREE];
+	int n = prefetcher->access(arg >> index_shift, miss, first_use, blocks);
+	num_prefetch_fills = 0;
+	int i;
+	for (i = 0; i < n; i++)
+		prefetch_fill<P>(blocks[i]);
+}
 
-			int dirty = 0;
-			if (type == 'w')
-				dirty = 1;
-			//overwrite the evicted block with the new field values
-			setValues(evict_num, set_num, tag_value, dirty);
+/**
+ * Brings a block in on behalf of the prefetcher, unless it is present. The
+ * fill is not an access, but the write-back of a dirty victim is counted.
+ *
+ * @block_num The block number, the address without the block offset
+ */
+template <class P>
+void Cache::prefetch_fill(uint64_t block_num) {
+	uint64_t set_num = block_num & index_mask;
+	uint64_t tag_value = block_num >> set_bits;
+	uint64_t base = set_num * way_num;
+	int i = way_search.vectorized ? way_search.find_tag(tags + base, block_state + base, way_num, tag_value)
+	                              : find_tag_scalar(tags + base, block_state + base, way_num, tag_value);
+	if (i >= 0)
+		return;
+
+	cache_victim_t& victim = prefetch_fills[num_prefetch_fills].victim;
+	prefetch_fills[num_prefetch_fills++].address = block_num << index_shift;
+	i = fill<P>(set_num, tag_value, 0, &victim);
+	block_state[base + i] |= BLOCK_PREFETCHED;
+	prefetch_time[base + i] = stats.accesses;
+	stats.prefetches++;
+	if (victim.valid) {
+		if (victim.dirty) {
+			stats.write_back_l1++;
+			write_next(victim.address >> index_shift);
 		}
+		uint64_t victim_num = victim.address >> index_shift;
+		pollution_filter[victim_num & (num_sets * way_num - 1)] = victim_num + 1;
 	}
 }
 
 /**
- * Subroutine for cleaning up any outstanding memory operations and calculating overall statistics
- * such as miss rate or average access time.
- * XXX: You're responsible for completing this routine
+ * Brings a block into its set, into an empty way if there is one and
+ * otherwise in place of the victim the replacement policy picks
+ *
+ * @set_num the set number
+ * @tag_value the tag
+ * @dirty block is dirty or not
+ * @p_victim Set to the evicted block
+ * @return the way the block went into
+ */
+template <class P>
+__attribute__((always_inline)) inline int Cache::fill(uint64_t set_num, uint64_t tag_value, int dirty, cache_victim_t* p_victim) {
+	uint64_t base = set_num * way_num;
+	uint8_t* set_state = block_state + base;
+
+	//search the blocks to find if there is an empty block
+	int i = way_search.vectorized ? way_search.find_empty(set_state, way_num)
+	                              : find_empty_scalar(set_state, way_num);
+
+	if (i >= 0) {
+		//bring in the required block and set the state
+		p_victim->valid = false;
+		set_values(base + i, tag_value, dirty);
+		P::insert(&repl, set_num, i);
+		return i;
+	}
+
+	//set is full, need to find a victim
+	int evict_num = P::victim(&repl, set_num);
+
+	p_victim->valid = true;
+	p_victim->dirty = (set_state[evict_num] & BLOCK_DIRTY) != 0;
+	p_victim->address = (tags[base + evict_num] << tag_shift) | (set_num << index_shift);
+	if (set_state[evict_num] & BLOCK_PREFETCHED)
+		stats.prefetch_useless++;
+	//overwrite the evicted block with the new field values
+	set_values(base + evict_num, tag_value, dirty);
+	P::insert(&repl, set_num, evict_num);
+	return evict_num;
+}
+
+/**
+ * fill for the cache's replacement policy
+ */
+void Cache::fill_block(uint64_t set_num, uint64_t tag_value, int dirty, cache_victim_t* p_victim) {
+	switch (policy) {
+	case REPL_TREE_PLRU:
+		fill<tree_plru_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	case REPL_BIT_PLRU:
+		fill<bit_plru_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	case REPL_SRRIP:
+		fill<srrip_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	case REPL_BRRIP:
+		fill<brrip_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	case REPL_FIFO:
+		fill<fifo_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	case REPL_RANDOM:
+		fill<random_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	case REPL_LFU:
+		fill<lfu_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	case REPL_OPT:
+		fill<opt_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	default:
+		fill<lru_policy>(set_num, tag_value, dirty, p_victim);
+		break;
+	}
+}
+
+/**
+ * Marks a block as just used for the cache's replacement policy
+ *
+ * @set_num the set number
+ * @way the way within the set
+ */
+void Cache::touch_block(uint64_t set_num, int way) {
+	switch (policy) {
+	case REPL_TREE_PLRU:
+		tree_plru_policy::touch(&repl, set_num, way);
+		break;
+	case REPL_BIT_PLRU:
+		bit_plru_policy::touch(&repl, set_num, way);
+		break;
+	case REPL_SRRIP:
+	case REPL_BRRIP:
+		srrip_policy::touch(&repl, set_num, way);
+		break;
+	case REPL_FIFO:
+	case REPL_RANDOM:
+		break;
+	case REPL_LFU:
+		lfu_policy::touch(&repl, set_num, way);
+		break;
+	case REPL_OPT:
+		opt_policy::touch(&repl, set_num, way);
+		break;
+	default:
+		lru_policy::touch(&repl, set_num, way);
+		break;
+	}
+}
+
+/**
+ * Finds the block holding an address
+ *
+ * @arg The target memory address
+ * @return the block number, set number * way_num + way number, or -1
+ */
+int64_t Cache::find_block(uint64_t arg) {
+	uint64_t set_num = (arg >> index_shift) & index_mask;
+	uint64_t base = set_num * way_num;
+	int i = way_search.vectorized ? way_search.find_tag(tags + base, block_state + base, way_num, arg >> tag_shift)
+	                              : find_tag_scalar(tags + base, block_state + base, way_num, arg >> tag_shift);
+	return i >= 0 ? (int64_t) (base + i) : -1;
+}
+
+/**
+ * A read lookup that is counted like access, but removes the block on a hit
+ * instead of bringing it in on a miss. An exclusive lower level uses this
+ * when the level above misses.
+ *
+ * @arg The target memory address
+ * @p_dirty Set to the dirty bit of the removed block
+ */
+bool Cache::extract(uint64_t arg, bool* p_dirty) {
+	stats.accesses++;
+	stats.reads++;
+	if (invalidate(arg, p_dirty)) {
+		stats.total_hits_l1++;
+		stats.read_hits_l1++;
+		return true;
+	}
+	stats.total_misses_l1++;
+	stats.read_misses_l1++;
+	return false;
+}
+
+/**
+ * Removes a block without counting an access, e.g. a back-invalidation
+ *
+ * @arg The target memory address
+ * @p_dirty Set to the dirty bit of the removed block
+ */
+bool Cache::invalidate(uint64_t arg, bool* p_dirty) {
+	int64_t block = find_block(arg);
+	if (block < 0)
+		return false;
+	*p_dirty = (block_state[block] & BLOCK_DIRTY) != 0;
+	block_state[block] = 0;
+	return true;
+}
+
+/**
+ * Places a block as just used without counting an access, e.g. a
+ * victim moving into an exclusive lower level
+ *
+ * @arg The target memory address
+ * @dirty block is dirty or not
+ * @p_victim Set to the evicted block
+ */
+void Cache::insert(uint64_t arg, bool dirty, cache_victim_t* p_victim) {
+	int64_t block = find_block(arg);
+	if (block >= 0) {
+		p_victim->valid = false;
+		if (dirty)
+			block_state[block] |= BLOCK_DIRTY;
+		touch_block(block / way_num, (int) (block % way_num));
+		return;
+	}
+	fill_block((arg >> index_shift) & index_mask, arg >> tag_shift, dirty, p_victim);
+}
+
+/**
+ * Sets the dirty bit of a block if it is present
+ *
+ * @arg The target memory address
+ */
+void Cache::set_dirty(uint64_t arg) {
+	int64_t block = find_block(arg);
+	if (block >= 0)
+		block_state[block] |= BLOCK_DIRTY;
+}
+
+/**
+ * Flushes the hit/miss log and calculates overall statistics such as miss
+ * rate or average access time
  *
  * @p_stats Pointer to the statistics structure
  */
-void complete_cache(cache_stats_t *p_stats) {
-	int i;
-	for (i = 0; i < way_num; i++) {
-		delete[] cache[i];
+void Cache::complete(cache_stats_t* p_stats) {
+	if (log_mode == LOG_BITS)
+		flush_log_bits();
+	if (log_mode != LOG_NONE)
+		fflush(log_out);
+	if (write_buffer != NULL) {
+		//whatever is still queued goes out at the end of the trace
+		stats.next_level_writes += write_buffer->drain();
+		stats.write_buffer_merges = write_buffer->merges;
+		stats.write_buffer_stalls = write_buffer->stalls;
 	}
 
-	delete[] cache;
-	float HT = 2 + (0.2 * S);
-	float MP = 20;
-	float MR = total_misses_l1 / (float) accesses;
-	p_stats->accesses = accesses;
-	p_stats->reads = reads;
-	p_stats->read_hits_l1 = read_hits_l1;
-	p_stats->read_misses_l1 = read_misses_l1;
-	p_stats->writes = writes;
-	p_stats->write_hits_l1 = write_hits_l1;
-	p_stats->write_misses_l1 = write_misses_l1;
-	p_stats->write_back_l1 = write_back_l1;
-	p_stats->total_hits_l1 = total_hits_l1;
-	p_stats->total_misses_l1 = total_misses_l1;
-	p_stats->total_hit_ratio = total_hits_l1 / (float) accesses;
-	p_stats->total_miss_ratio = total_misses_l1 / (float) accesses;
-	p_stats->read_hit_ratio = read_hits_l1 / (float) reads;
-	p_stats->read_miss_ratio = read_misses_l1 / (float)reads;
-	p_stats->write_hit_ratio = write_hits_l1 / (float) writes;
-	p_stats->write_miss_ratio = write_misses_l1 / (float) writes;
-	p_stats->avg_access_time_l1 = HT + (MR * MP);
-
-}
-
-/**
-* Subroutine for setting the different fields of a block
+	if (interval_out != NULL) {
+		log_interval();
+		fflush(interval_out);
+	}
+
+	*p_stats = stats;
+	calculate_ratios(p_stats, S);
+}
+
+/**
+* Sets the different fields of a block
 *
-* @i the way number
-* @set_num the set number
+* @block the block number, set number * way_num + way number
 * @tag_value the tag
 * @dirty block is dirty or not
 */
-void setValues(int i, int set_num, long tag_value, int dirty) {
-	cache[i][set_num].dirty_bit = dirty;
-	cache[i][set_num].valid_bit = 1;
-	cache[i][set_num].tag = tag_value;
-	cache[i][set_num].LRUNum = time_counter++;
+void Cache::set_values(uint64_t block, uint64_t tag_value, int dirty) {
+	block_state[block] = BLOCK_VALID | (dirty ? BLOCK_DIRTY : 0);
+	tags[block] = tag_value;
 }
 
 /**
-* Subroutine for creating a mask to get required bits from an address
-*
-* @a the starting index of the required bits
-* @b the ending index of the required bits
-*/
-unsigned createMask(unsigned a, unsigned b)
-{
-	unsigned r = 0;
-	unsigned i;
-	for (i = a; i <= b; i++)
-		r |= 1 << i;
-
-	return r;
+ * Subroutine for calculating the hit/miss ratios and the average access time
+ * from the counters in the statistics structure
+ *
+ * @p_stats Pointer to the statistics structure
+ * @s1 The number of blocks in each set of L1: 2^s blocks per set.
+ */
+void calculate_ratios(cache_stats_t *p_stats, uint64_t s1) {
+	float HT = 2 + (0.2 * s1);
+	float MP = 20;
+	float MR = p_stats->total_misses_l1 / (float) p_stats->accesses;
+	p_stats->total_hit_ratio = p_stats->total_hits_l1 / (float) p_stats->accesses;
+	p_stats->total_miss_ratio = p_stats->total_misses_l1 / (float) p_stats->accesses;
+	p_stats->read_hit_ratio = p_stats->read_hits_l1 / (float) p_stats->reads;
+	p_stats->read_miss_ratio = p_stats->read_misses_l1 / (float) p_stats->reads;
+	p_stats->write_hit_ratio = p_stats->write_hits_l1 / (float) p_stats->writes;
+	p_stats->write_miss_ratio = p_stats->write_misses_l1 / (float) p_stats->writes;
+	//a late prefetch hit also waits for the rest of its fill
+	p_stats->avg_access_time_l1 = HT + (MR * MP) + p_stats->prefetch_late_cycles / (double) p_stats->accesses;
+	uint64_t prefetchable = p_stats->prefetch_useful + p_stats->total_misses_l1;
+	p_stats->prefetch_accuracy = p_stats->prefetches ? p_stats->prefetch_useful / (double) p_stats->prefetches : 0;
+	p_stats->prefetch_coverage = prefetchable ? p_stats->prefetch_useful / (double) prefetchable : 0;
+}
+
+/**
+ * Subroutine for adding the counters of a partial run, e.g. one thread's
+ * share of the sets, to a total. The ratios are left to calculate_ratios.
+ *
+ * @p_total Pointer to the statistics structure being summed into
+ * @p_part Pointer to the statistics of the partial run
+ */
+void accumulate_stats(cache_stats_t *p_total, const cache_stats_t *p_part) {
+	p_total->accesses += p_part->accesses;
+	p_total->reads += p_part->reads;
+	p_total->read_hits_l1 += p_part->read_hits_l1;
+	p_total->read_misses_l1 += p_part->read_misses_l1;
+	p_total->writes += p_part->writes;
+	p_total->write_hits_l1 += p_part->write_hits_l1;
+	p_total->write_misses_l1 += p_part->write_misses_l1;
+	p_total->write_back_l1 += p_part->write_back_l1;
+	p_total->total_hits_l1 += p_part->total_hits_l1;
+	p_total->total_misses_l1 += p_part->total_misses_l1;
+	p_total->prefetches += p_part->prefetches;
+	p_total->prefetch_useful += p_part->prefetch_useful;
+	p_total->prefetch_late += p_part->prefetch_late;
+	p_total->prefetch_late_cycles += p_part->prefetch_late_cycles;
+	p_total->prefetch_useless += p_part->prefetch_useless;
+	p_total->prefetch_pollution += p_part->prefetch_pollution;
+	p_total->next_level_writes += p_part->next_level_writes;
+	p_total->write_buffer_merges += p_part->write_buffer_merges;
+	p_total->write_buffer_stalls += p_part->write_buffer_stalls;
 }
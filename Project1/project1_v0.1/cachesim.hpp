@@ -3,10 +3,17 @@
 
 #ifdef CCOMPILER
 #include <stdint.h>
+#include <stdio.h>
 #else
 #include <cstdint>
+#include <cstdio>
 #endif
 
+#include "prefetch.hpp"
+#include "replacement.hpp"
+#include "way_search.hpp"
+#include "write_buffer.hpp"
+
 struct cache_stats_t {
     uint64_t accesses;
     uint64_t reads;
@@ -25,12 +32,181 @@ struct cache_stats_t {
     double write_hit_ratio;
     double write_miss_ratio;
     double avg_access_time_l1;
+    //prefetching, all zero unless a prefetcher is set
+    uint64_t prefetches;            /* blocks brought in by the prefetcher */
+    uint64_t prefetch_useful;       /* prefetched blocks hit by a demand access */
+    uint64_t prefetch_late;         /* useful ones hit within PREFETCH_LATENCY accesses */
+    uint64_t prefetch_late_cycles;  /* what late ones still waited for their fill, added to the AAT */
+    uint64_t prefetch_useless;      /* prefetched blocks evicted unused */
+    uint64_t prefetch_pollution;    /* demand misses to blocks a prefetch evicted */
+    double prefetch_accuracy;       /* useful / prefetches */
+    double prefetch_coverage;       /* useful / (useful + demand misses) */
+    //write traffic to the next level, in blocks: write-backs plus the
+    //written-through writes, less what the write-combining buffer merged
+    uint64_t next_level_writes;
+    uint64_t write_buffer_merges;   /* writes merged into a queued block */
+    uint64_t write_buffer_stalls;   /* writes that found the buffer full */
 };
 
-void setup_cache(uint64_t c1, uint64_t b1, uint64_t s1);
+void setup_cache(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy = REPL_LRU);
 
 void cache_access(char type, uint64_t arg, cache_stats_t* p_stats);
 void complete_cache(cache_stats_t *p_stats);
+void calculate_ratios(cache_stats_t *p_stats, uint64_t s1);
+void accumulate_stats(cache_stats_t *p_total, const cache_stats_t *p_part);
+
+/** Per-access hit/miss log written by cache_access */
+enum hitmiss_log_t {
+    LOG_NONE,   /* no per-access output (default) */
+    LOG_TEXT,   /* one "H" or "M" line per access, the graded output format */
+    LOG_BITS    /* packed bitstream, 1 bit per access (1 = hit), LSB first */
+};
+
+void set_hitmiss_log(hitmiss_log_t mode, FILE* out);
+void set_prefetcher(const prefetch_config_t* p_config);
+void set_write_config(const write_config_t* p_config);
+void set_interval_log(uint64_t interval, FILE* out);
+
+/** A block evicted from a cache to make room for another */
+struct cache_victim_t {
+    bool valid;                 /* false if the fill used an empty way */
+    bool dirty;
+    uint64_t address;           /* address of the first byte of the block */
+};
+
+/** A block brought in by the prefetcher and the block it evicted */
+struct prefetch_fill_t {
+    uint64_t address;           /* address of the first byte of the block */
+    cache_victim_t victim;
+};
+
+/*
+ * A self-contained cache. setup_cache, cache_access and complete_cache are
+ * thin wrappers over a default instance; code that needs several caches in
+ * one process (sweeps, sharded runs, multi-level models) creates its own.
+ */
+class Cache {
+public:
+    Cache(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy = REPL_LRU);
+    ~Cache();
+
+    void access(char type, uint64_t arg);
+    void complete(cache_stats_t* p_stats);
+    void set_hitmiss_log(hitmiss_log_t mode, FILE* out);
+    /** Prefetches on demand accesses from now on, see prefetch.hpp */
+    void set_prefetcher(const prefetch_config_t* p_config);
+    /** Selects the write policies and write-combining buffer, see write_buffer.hpp */
+    void set_write_config(const write_config_t* p_config);
+    /**
+     * Writes a csv record of the accesses, misses and write-backs of every
+     * interval accesses to out, the last one at complete for what is left
+     */
+    void set_interval_log(uint64_t interval, FILE* out);
+
+    //block-level operations used to build multi-level hierarchies
+
+    /** access, also reporting the block evicted on a miss; returns true on a hit */
+    bool access(char type, uint64_t arg, cache_victim_t* p_victim);
+    /** A read lookup counted like access that removes the block on a hit */
+    bool extract(uint64_t arg, bool* p_dirty);
+    /** Removes a block without counting an access, returns true if it was present */
+    bool invalidate(uint64_t arg, bool* p_dirty);
+    /** Places a block as just used without counting an access */
+    void insert(uint64_t arg, bool dirty, cache_victim_t* p_victim);
+    /** Sets the dirty bit of a block if it is present */
+    void set_dirty(uint64_t arg);
+    /**
+     * The blocks the prefetcher brought in during the last access, in order,
+     * so that a level behind the cache can take their victims
+     */
+    int last_prefetch_fills(const prefetch_fill_t** p_fills) const {
+        *p_fills = prefetch_fills;
+        return num_prefetch_fills;
+    }
+
+    /** OPT only: the trace position at which the block of the next access is used again */
+    void set_next_use(uint64_t position) { repl.next_use = position; }
+    /**
+     * For a cache holding one shard of a larger one's sets: set n here is set
+     * n * stride + offset there, so the random policies draw as that one does
+     */
+    void set_shard(uint64_t stride, uint64_t offset) { replacement_set_numbering(&repl, stride, offset); }
+
+private:
+    Cache(const Cache&);
+    Cache& operator=(const Cache&);
+
+    //the access path is instantiated once per replacement policy P, and the
+    //non-template members below pick the instance for the cache's policy
+    template <class P> bool lookup_fill(char type, uint64_t arg, cache_victim_t* p_victim);
+    template <class P> int fill(uint64_t set_num, uint64_t tag_value, int dirty, cache_victim_t* p_victim);
+    template <class P> void prefetch(uint64_t arg, bool miss, bool first_use);
+    template <class P> void prefetch_fill(uint64_t block_num);
+    void fill_block(uint64_t set_num, uint64_t tag_value, int dirty, cache_victim_t* p_victim);
+    void touch_block(uint64_t set_num, int way);
+    int64_t find_block(uint64_t arg);
+    void set_values(uint64_t block, uint64_t tag_value, int dirty);
+    void write_next(uint64_t block_num);
+    void log_interval();
+    void log_access(bool hit);
+    void flush_log_bits();
+
+    //geometry of the cache
+    int set_bits, way_num, S;
+    uint64_t num_sets;
+
+    //address decomposition, precomputed once in the constructor:
+    //set = (address >> index_shift) & index_mask, tag = address >> tag_shift
+    int index_shift, tag_shift;
+    uint64_t index_mask;
+
+    //the cache is stored set-major in one allocation: the ways of set n are
+    //entries n*way_num .. n*way_num+way_num-1 of each array, so the tags of a
+    //set are contiguous and an 8-way set of tags is exactly one 64-byte line
+    void* storage;
+    uint64_t* tags;
+    uint8_t* block_state;
+
+    //hit and empty way searches over one set, vectorized when the CPU allows
+    way_search_t way_search;
+
+    //the replacement policy and only the per-set state it needs
+    replacement_t policy;
+    replacement_state_t repl;
+
+    //hit/miss statistics, the ratios are filled in by complete
+    cache_stats_t stats;
+
+    //hit/miss log sink, nothing is written per access unless a log is requested
+    hitmiss_log_t log_mode;
+    FILE* log_out;
+    //bitstream mode packs hits and misses into this buffer before writing it out
+    unsigned char* log_bits;
+    uint64_t log_bit_count;
+
+    //the prefetcher, NULL when off. prefetch_time holds the access count at
+    //which each prefetched block came in, and pollution_filter the last block
+    //a prefetch evicted from each slot, indexed by block number
+    Prefetcher* prefetcher;
+    uint64_t* prefetch_time;
+    uint64_t* pollution_filter;
+    prefetch_fill_t prefetch_fills[PREFETCH_MAX_DEGREE];
+    int num_prefetch_fills;
+
+    //write-back and write-allocate unless set_write_config says otherwise;
+    //the write-combining buffer is NULL when writes go straight out
+    bool write_through;
+    bool write_allocate;
+    WriteBuffer* write_buffer;
+
+    //interval log, off while interval_end is UINT64_MAX: the access path
+    //only compares the access count with interval_end, and the record is
+    //the difference of the counters from the copy taken at the last one
+    uint64_t interval;
+    uint64_t interval_end;
+    FILE* interval_out;
+    cache_stats_t interval_start;
+};
 
 static const uint64_t DEFAULT_C1 = 12;   /* 4KB Cache */
 static const uint64_t DEFAULT_B1 = 5;    /* 32-byte blocks */
@@ -0,0 +1,209 @@
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Simulator throughput benchmark, run by make bench. Every case replays a
+ * generated binary trace through ./cachesim in a child process several
+ * times; the wall time of each run and the peak RSS of the child come from
+ * the clock and wait4, so the numbers include loading the trace, as a user
+ * would see them.
+ */
+
+/** A trace made by trace_gen, see bench_traces */
+struct bench_trace_t {
+    const char* name;
+    const char* gen_args;           /* pattern options of trace_gen */
+};
+
+//read-heavy and write-heavy mixes over footprints well beyond the small and
+//the large cache, so both see misses and write-backs
+static const bench_trace_t bench_traces[] = {
+    { "zipf-read", "-p zipf -m 67108864 -w 10" },
+    { "random-write", "-p random -m 67108864 -w 70" },
+};
+static const int bench_c[] = { 12, 22 };               /* 4KB and 4MB */
+static const int bench_s[] = { 0, 3, 5 };              /* direct-mapped, 8-way, 32-way */
+static const int BENCH_B = 6;
+
+void print_help_and_exit(void) {
+    printf("cachesim_bench [OPTIONS]\n");
+    printf("Times ./cachesim on generated traces, C in {12, 22}, S in {0, 3, 5}, B %d\n", BENCH_B);
+    printf("-h\t\tThis helpful output\n");
+    printf("-n N\t\tAccesses per trace (default 5000000)\n");
+    printf("-r RUNS\t\tRuns per case (default 5)\n");
+    printf("-d DIR\t\tWhere the traces are generated (default $TMPDIR or /tmp)\n");
+    printf("-F FMT\t\tcsv (default) or json, one object per line\n");
+    exit(0);
+}
+
+/**
+ * Runs a command with its output discarded
+ *
+ * @argv The program and its arguments, NULL terminated
+ * @p_usage Set to the resource usage of the child
+ * @return the exit status, -1 if it could not be run
+ */
+static int run(std::vector<const char*>& argv, struct rusage* p_usage) {
+    argv.push_back(NULL);
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        execv(argv[0], (char* const*) &argv[0]);
+        _exit(127);
+    }
+    int status;
+    if (wait4(pid, &status, 0, p_usage) != pid)
+        return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/** Splits a string on spaces onto argv, the words stay in storage */
+static void split_args(const char* args, std::vector<std::string>* p_storage, std::vector<const char*>* p_argv) {
+    char word[256];
+    int used;
+    while (sscanf(args, " %255s%n", word, &used) == 1) {
+        p_storage->push_back(word);
+        args += used;
+    }
+    size_t i;
+    for (i = 0; i < p_storage->size(); i++)
+        p_argv->push_back((*p_storage)[i].c_str());
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    uint64_t accesses = 5000000;
+    int runs = 5;
+    const char* dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    bool json = false;
+
+    while(-1 != (opt = getopt(argc, argv, "n:r:d:F:h"))) {
+        switch(opt) {
+        case 'n':
+            accesses = strtoull(optarg, NULL, 10);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            if (runs < 1)
+                print_help_and_exit();
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        case 'F':
+            if (!strcmp(optarg, "json"))
+                json = true;
+            else if (strcmp(optarg, "csv"))
+                print_help_and_exit();
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    /* Generate the traces */
+    int num_traces = sizeof(bench_traces) / sizeof(bench_traces[0]);
+    std::vector<std::string> paths;
+    int t;
+    for (t = 0; t < num_traces; t++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/cachesim_bench_%s_%" PRIu64 ".bt", dir, bench_traces[t].name, accesses);
+        paths.push_back(path);
+        if (access(path, R_OK) == 0)
+            continue;
+        char count[32];
+        snprintf(count, sizeof(count), "%" PRIu64, accesses);
+        std::vector<std::string> storage;
+        std::vector<const char*> gen;
+        gen.push_back("./trace_gen");
+        split_args(bench_traces[t].gen_args, &storage, &gen);
+        const char* rest[] = { "-B", "-n", count, "-o", path };
+        gen.insert(gen.end(), rest, rest + 5);
+        struct rusage usage;
+        if (run(gen, &usage) != 0) {
+            fprintf(stderr, "cachesim_bench: cannot generate %s\n", path);
+            unlink(path);
+            return 1;
+        }
+    }
+
+    if (!json)
+        printf("trace,c,b,s,accesses,runs,median_seconds,stddev_seconds,accesses_per_second,ns_per_access,"
+               "peak_rss_kb\n");
+    size_t ci, si;
+    for (t = 0; t < num_traces; t++) {
+        for (ci = 0; ci < sizeof(bench_c) / sizeof(bench_c[0]); ci++) {
+            for (si = 0; si < sizeof(bench_s) / sizeof(bench_s[0]); si++) {
+                char c[16], b[16], s[16];
+                snprintf(c, sizeof(c), "%d", bench_c[ci]);
+                snprintf(b, sizeof(b), "%d", BENCH_B);
+                snprintf(s, sizeof(s), "%d", bench_s[si]);
+
+                std::vector<double> seconds;
+                long peak_rss_kb = 0;
+                int r;
+                for (r = 0; r < runs; r++) {
+                    std::vector<const char*> sim;
+                    const char* args[] = { "./cachesim", "-c", c, "-b", b, "-s", s, "-f", paths[t].c_str() };
+                    sim.assign(args, args + 9);
+                    struct rusage usage;
+                    double start = now_seconds();
+                    if (run(sim, &usage) != 0) {
+                        fprintf(stderr, "cachesim_bench: ./cachesim failed on %s\n", paths[t].c_str());
+                        return 1;
+                    }
+                    seconds.push_back(now_seconds() - start);
+                    peak_rss_kb = std::max(peak_rss_kb, usage.ru_maxrss);
+                }
+
+                std::sort(seconds.begin(), seconds.end());
+                double median = runs % 2 ? seconds[runs / 2] : (seconds[runs / 2 - 1] + seconds[runs / 2]) / 2;
+                double mean = 0;
+                for (r = 0; r < runs; r++)
+                    mean += seconds[r] / runs;
+                double variance = 0;
+                for (r = 0; r < runs; r++)
+                    variance += (seconds[r] - mean) * (seconds[r] - mean);
+                double stddev = runs > 1 ? sqrt(variance / (runs - 1)) : 0;
+                double rate = accesses / median;
+
+                if (json) {
+                    printf("{\"trace\": \"%s\", \"c\": %s, \"b\": %s, \"s\": %s, \"accesses\": %" PRIu64
+                           ", \"runs\": %d, \"median_seconds\": %.6f, \"stddev_seconds\": %.6f"
+                           ", \"accesses_per_second\": %.0f, \"ns_per_access\": %.3f, \"peak_rss_kb\": %ld}\n",
+                           bench_traces[t].name, c, b, s, accesses, runs, median, stddev, rate, 1e9 / rate,
+                           peak_rss_kb);
+                } else {
+                    printf("%s,%s,%s,%s,%" PRIu64 ",%d,%.6f,%.6f,%.0f,%.3f,%ld\n", bench_traces[t].name, c, b, s,
+                           accesses, runs, median, stddev, rate, 1e9 / rate, peak_rss_kb);
+                }
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
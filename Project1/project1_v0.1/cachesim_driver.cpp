@@ -12,37 +12,294 @@
 #endif
 
 #include <unistd.h>
+#include <new>
+#include <thread>
+#include <vector>
 #include "cachesim.hpp"
+#include "hierarchy.hpp"
+#include "miss_class.hpp"
+#include "mshr.hpp"
+#include "opt.hpp"
+#include "reuse_distance.hpp"
+#include "set_sample.hpp"
+#include "shard.hpp"
+#include "spsc_ring.hpp"
+#include "stack_distance.hpp"
+#include "sweep.hpp"
+#include "trace.hpp"
+#include "victim_cache.hpp"
 
 void print_help_and_exit(void) {
     printf("cachesim [OPTIONS] < traces/file.trace\n");
+    printf("cachesim [OPTIONS] -f traces/file.trace\n");
     printf("-h\t\tThis helpful output\n");
+    printf("-f FILE\t\tRead the trace from FILE, text, binary or compressed (see trace_convert)\n");
+    printf("-v MODE\t\tHit/miss log: none (default), text (H/M per line) or bits\n");
+    printf("-o FILE\t\tWrite the bits log to FILE, 1 bit per access (1 = hit), LSB first\n");
+    printf("-I N[,FILE]\tWrite a csv record of the L1 accesses, misses, write-backs and\n");
+    printf("\t\tmiss ratio of every N accesses to FILE (default: stderr)\n");
     printf("L1 parameters:\n");
     printf("  -c C1\t\tTotal size in bytes is 2^C1\n");
     printf("  -b B1\t\tSize of each block in bytes is 2^B1\n");
     printf("  -s S1\t\tNumber of blocks per set is 2^S1\n");
+    printf("  -r POLICY\tReplacement policy of every level: lru (default), tree-plru,\n");
+    printf("\t\tbit-plru, srrip, brrip, fifo, random, lfu or opt (Belady, single L1\n");
+    printf("\t\tonly; the trace is preprocessed into a next-use index in $TMPDIR)\n");
+    printf("  -p KIND[,DEG[,DIST]]\tPrefetch into L1: none (default), next-line, stride\n");
+    printf("\t\tor stream, DEG blocks per trigger starting DIST blocks (or\n");
+    printf("\t\tstrides) ahead, both 1 by default\n");
+    printf("  -V N\t\tAdd a fully associative victim cache of N blocks (a power of\n");
+    printf("\t\ttwo) behind L1\n");
+    printf("  -w HIT[,MISS]\tL1 write policies: back (default) or through on a write\n");
+    printf("\t\thit, allocate (default) or no-allocate on a write miss\n");
+    printf("  -W N[,R]\tPut a write-combining buffer of N blocks between L1 and the\n");
+    printf("\t\tnext level, writing one block out every R accesses (default 4)\n");
+    printf("  -M N[,ISSUE]\tTime a non-blocking L1 with N MSHRs (at most 64), one access\n");
+    printf("\t\tissuing every ISSUE cycles (default 1)\n");
+    printf("  -3\t\tClassify the misses as compulsory, capacity or conflict\n");
+    printf("  -d\t\tAlso print the fully associative reuse distance histogram\n");
+    printf("Lower levels:\n");
+    printf("  -L C,B,S[,HT]\tAdd a level below the last one (L2, then L3), 2^C bytes,\n");
+    printf("\t\t2^B-byte blocks, 2^S ways, hit time HT (default 2 + 0.2*S)\n");
+    printf("  -i POLICY\tInclusion of the lower levels: nine (default), inclusive\n");
+    printf("\t\tor exclusive\n");
+    printf("Design-space sweep:\n");
+    printf("  -c, -b and -s also take a range LO:HI. With more than one configuration,\n");
+    printf("  or with -F, every valid (C1, B1, S1) is simulated over the in-memory trace\n");
+    printf("  -j N\t\tRun the sweep on N threads (default: one per core)\n");
+    printf("  -F FMT\tPrint one row per configuration as csv (default) or json\n");
+    printf("Parallel simulation:\n");
+    printf("  -j N\t\tSplit a single configuration by set index over N threads;\n");
+    printf("\t\tthe statistics are identical to a serial run\n");
+    printf("Approximation:\n");
+    printf("  -e N\t\tSimulate one set in N (hashed) and scale the statistics up to\n");
+    printf("\t\tthe whole L1, with 95%% confidence intervals on the miss ratio\n");
+    printf("  -a SMAX\tSimulate every associativity 2^0..2^SMAX in one pass, keeping\n");
+    printf("\t\tB1 and the number of sets 2^(C1-B1-S1) fixed\n");
     exit(0);
 }
 
+/** Called for every access of the trace being replayed */
+typedef void (*access_fn_t)(char type, uint64_t arg, cache_stats_t* p_stats);
+
 void print_statistics(cache_stats_t* p_stats);
+void print_hierarchy_statistics(hierarchy_stats_t* p_stats);
+void print_miss_classification(miss_class_stats_t* p_stats);
+void print_prefetch_statistics(cache_stats_t* p_stats);
+void print_victim_statistics(victim_cache_stats_t* p_stats);
+void print_write_statistics(cache_stats_t* p_stats, const write_config_t* p_write);
+void sample_and_exit(const char* trace_path, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy,
+                     uint64_t ratio);
+void print_sample_statistics(set_sample_stats_t* p_stats);
+void mshr_and_exit(const char* trace_path, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy, int mshrs,
+                   double issue_interval);
+void print_mshr_statistics(mshr_stats_t* p_stats);
+void victim_and_exit(const char* trace_path, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy,
+                     uint64_t entries, const prefetch_config_t* p_prefetch, hitmiss_log_t log_mode,
+                     const char* log_path);
+void print_reuse_histogram(reuse_histogram_t* p_hist, uint64_t b1);
+void classify_and_exit(const char* trace_path, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy,
+                       const prefetch_config_t* p_prefetch, hitmiss_log_t log_mode, const char* log_path);
+FILE* open_hitmiss_log(hitmiss_log_t log_mode, const char* log_path);
+FILE* open_interval_log(const char* interval_path);
+void hierarchy_and_exit(const char* trace_path, level_config_t* levels, int num_levels, inclusion_t inclusion,
+                        hitmiss_log_t log_mode, const char* log_path);
+void print_assoc_sweep(cache_stats_t* p_stats, uint64_t b1, uint64_t set_bits, uint64_t s_max);
+void replay_trace(const char* trace_path, access_fn_t access, cache_stats_t* p_stats);
+void parse_range(const char* arg, uint64_t* p_lo, uint64_t* p_hi);
+void sweep_and_exit(const char* trace_path, uint64_t c_lo, uint64_t c_hi, uint64_t b_lo, uint64_t b_hi,
+                    uint64_t s_lo, uint64_t s_hi, replacement_t policy, unsigned threads, sweep_format_t format);
+void replay_text_trace(FILE* in, access_fn_t access, cache_stats_t* p_stats);
+void replay_binary_trace(const mapped_trace_t* p_trace, access_fn_t access, cache_stats_t* p_stats);
+void replay_compressed_trace(const mapped_trace_t* p_trace, access_fn_t access, cache_stats_t* p_stats);
+
+static StackDistance* stack_sim;
+
+static void stack_access(char type, uint64_t arg, cache_stats_t* p_stats) {
+    stack_sim->access(type, arg);
+}
+
+static Hierarchy* hierarchy;
+
+static void hierarchy_access(char type, uint64_t arg, cache_stats_t* p_stats) {
+    hierarchy->access(type, arg);
+}
+
+static ReuseDistance* reuse;
+
+static void reuse_access(char type, uint64_t arg, cache_stats_t* p_stats) {
+    cache_access(type, arg, p_stats);
+    reuse->access(arg);
+}
+
+static VictimCache* victim_cache;
+
+static void victim_access(char type, uint64_t arg, cache_stats_t* p_stats) {
+    victim_cache->access(type, arg);
+}
+
+static MshrTiming* mshr_timing;
+
+static void mshr_access(char type, uint64_t arg, cache_stats_t* p_stats) {
+    mshr_timing->access(type, arg);
+}
+
+static SetSampler* sampler;
+
+static void sample_access(char type, uint64_t arg, cache_stats_t* p_stats) {
+    sampler->access(type, arg);
+}
+
+static Cache* classified_cache;
+static MissClassifier* classifier;
+
+static void classified_access(char type, uint64_t arg, cache_stats_t* p_stats) {
+    cache_victim_t victim;
+    bool hit = classified_cache->access(type, arg, &victim);
+    classifier->access(type, arg, hit);
+}
 
 int main(int argc, char* argv[]) {
     int opt;
     uint64_t c1 = DEFAULT_C1;
     uint64_t b1 = DEFAULT_B1;
     uint64_t s1 = DEFAULT_S1;
+    const char* trace_path = NULL;
+    hitmiss_log_t log_mode = LOG_NONE;
+    const char* log_path = NULL;
+    int s_max = -1;
+    uint64_t c_hi = DEFAULT_C1;
+    uint64_t b_hi = DEFAULT_B1;
+    uint64_t s_hi = DEFAULT_S1;
+    unsigned threads = 0;
+    int sweep_format = -1;
+    level_config_t levels[MAX_LEVELS];
+    int num_levels = 1;
+    inclusion_t inclusion = NINE;
+    replacement_t policy = REPL_LRU;
+    bool classify = false;
+    bool histogram = false;
+    prefetch_config_t prefetch = { PREFETCH_NONE, 1, 1 };
+    uint64_t victim_entries = 0;
+    write_config_t write = { false, true, 0, 0 };
+    bool write_set = false;
+    uint64_t sample_ratio = 0;
+    uint64_t interval = 0;
+    int mshrs = 0;
+    double issue_interval = 1;
+    const char* interval_path = NULL;
 
     /* Read arguments */
-    while(-1 != (opt = getopt(argc, argv, "c:b:s:v:C:B:S:h"))) {
+    while(-1 != (opt = getopt(argc, argv, "c:b:s:r:p:V:w:W:e:I:M:3da:j:F:L:i:f:v:o:C:B:S:h"))) {
         switch(opt) {
         case 'c':
-            c1 = atoi(optarg);
+            parse_range(optarg, &c1, &c_hi);
             break;
         case 'b':
-            b1 = atoi(optarg);
+            parse_range(optarg, &b1, &b_hi);
             break;
         case 's':
-            s1 = atoi(optarg);
+            parse_range(optarg, &s1, &s_hi);
+            break;
+        case 'r':
+            if (parse_replacement(optarg, &policy) != 0)
+                print_help_and_exit();
+            break;
+        case 'p':
+            if (parse_prefetch(optarg, &prefetch) != 0)
+                print_help_and_exit();
+            break;
+        case 'V':
+            victim_entries = atoi(optarg);
+            if (victim_entries == 0 || (victim_entries & (victim_entries - 1)) != 0)
+                print_help_and_exit();
+            break;
+        case 'w':
+            if (parse_write_policy(optarg, &write) != 0)
+                print_help_and_exit();
+            write_set = true;
+            break;
+        case 'W':
+            if (parse_write_buffer(optarg, &write) != 0)
+                print_help_and_exit();
+            write_set = true;
+            break;
+        case 'e':
+            sample_ratio = atoi(optarg);
+            if (sample_ratio == 0)
+                print_help_and_exit();
+            break;
+        case 'I': {
+            interval = strtoull(optarg, NULL, 10);
+            const char* comma = strchr(optarg, ',');
+            if (comma != NULL)
+                interval_path = comma + 1;
+            if (interval == 0)
+                print_help_and_exit();
+            break;
+        }
+        case 'M':
+            if (sscanf(optarg, "%d,%lf", &mshrs, &issue_interval) < 1 || mshrs < 1 || mshrs > MSHR_MAX ||
+                issue_interval <= 0)
+                print_help_and_exit();
+            break;
+        case '3':
+            classify = true;
+            break;
+        case 'd':
+            histogram = true;
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'F':
+            if (!strcmp(optarg, "csv"))
+                sweep_format = SWEEP_CSV;
+            else if (!strcmp(optarg, "json"))
+                sweep_format = SWEEP_JSON;
+            else
+                print_help_and_exit();
+            break;
+        case 'a':
+            s_max = atoi(optarg);
+            break;
+        case 'L': {
+            level_config_t* p_level = &levels[num_levels];
+            p_level->hit_time = -1;
+            if (num_levels == MAX_LEVELS ||
+                sscanf(optarg, "%" SCNu64 ",%" SCNu64 ",%" SCNu64 ",%lf", &p_level->c, &p_level->b, &p_level->s,
+                       &p_level->hit_time) < 3 || p_level->c > 63 || p_level->b + p_level->s > p_level->c)
+                print_help_and_exit();
+            if (p_level->hit_time < 0)
+                p_level->hit_time = 2 + 0.2 * p_level->s;
+            num_levels++;
+            break;
+        }
+        case 'i':
+            if (!strcmp(optarg, "nine"))
+                inclusion = NINE;
+            else if (!strcmp(optarg, "inclusive"))
+                inclusion = INCLUSIVE;
+            else if (!strcmp(optarg, "exclusive"))
+                inclusion = EXCLUSIVE;
+            else
+                print_help_and_exit();
+            break;
+        case 'f':
+            trace_path = optarg;
+            break;
+        case 'v':
+            if (!strcmp(optarg, "none"))
+                log_mode = LOG_NONE;
+            else if (!strcmp(optarg, "text"))
+                log_mode = LOG_TEXT;
+            else if (!strcmp(optarg, "bits"))
+                log_mode = LOG_BITS;
+            else
+                print_help_and_exit();
+            break;
+        case 'o':
+            log_path = optarg;
             break;
         case 'h':
             /* Fall through */
@@ -52,36 +309,642 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    /* L1 needs at least one set; a sweep needs at least one such point */
+    if (c_hi > 63 || b_hi > 63 || s_hi > 63 || b1 + s1 > c_hi)
+        print_help_and_exit();
+
+    /* OPT and the L1 instrumentation need a single L1 replayed in order */
+    bool is_sweep = sweep_format >= 0 || c_hi != c1 || b_hi != b1 || s_hi != s1;
+    bool single_l1 = !is_sweep && num_levels == 1 && threads <= 1 && s_max < 0;
+    if (policy == REPL_OPT && (is_sweep || num_levels > 1 || threads > 1)) {
+        fprintf(stderr, "cachesim: -r opt simulates a single L1 on one thread\n");
+        exit(1);
+    }
+    if (classify && (!single_l1 || policy == REPL_OPT)) {
+        fprintf(stderr, "cachesim: -3 classifies a single L1 on one thread\n");
+        exit(1);
+    }
+    if (prefetch.kind != PREFETCH_NONE && (!single_l1 || policy == REPL_OPT)) {
+        fprintf(stderr, "cachesim: -p prefetches into a single L1 on one thread\n");
+        exit(1);
+    }
+    if (victim_entries > 0 && (!single_l1 || policy == REPL_OPT || classify)) {
+        fprintf(stderr, "cachesim: -V adds a victim cache to a single L1 on one thread\n");
+        exit(1);
+    }
+    if (write_set && (!single_l1 || policy == REPL_OPT || classify || victim_entries > 0)) {
+        fprintf(stderr, "cachesim: -w and -W go with a plain single L1 run\n");
+        exit(1);
+    }
+    if (sample_ratio > 0 && (!single_l1 || policy == REPL_OPT || classify || victim_entries > 0 || write_set ||
+                             histogram || prefetch.kind != PREFETCH_NONE || log_mode != LOG_NONE)) {
+        fprintf(stderr, "cachesim: -e samples a plain single L1 run without a log\n");
+        exit(1);
+    }
+    if (interval > 0 && (!single_l1 || policy == REPL_OPT || classify || victim_entries > 0 || sample_ratio > 0)) {
+        fprintf(stderr, "cachesim: -I logs a plain single L1 run\n");
+        exit(1);
+    }
+    if (mshrs > 0 && (!single_l1 || policy == REPL_OPT || classify || victim_entries > 0 || sample_ratio > 0 ||
+                      write_set || interval > 0 || histogram || prefetch.kind != PREFETCH_NONE ||
+                      log_mode != LOG_NONE)) {
+        fprintf(stderr, "cachesim: -M times a plain single L1 run without a log\n");
+        exit(1);
+    }
+    if (histogram && (!single_l1 || policy == REPL_OPT || classify || victim_entries > 0)) {
+        fprintf(stderr, "cachesim: -d goes with a plain single L1 run\n");
+        exit(1);
+    }
+    if (log_mode != LOG_NONE && (is_sweep || s_max >= 0 || threads > 1)) {
+        fprintf(stderr, "cachesim: -v logs a run in trace order, not a sweep, -a or -j\n");
+        exit(1);
+    }
+
+    if (is_sweep) {
+        sweep_and_exit(trace_path, c1, c_hi, b1, b_hi, s1, s_hi, policy,
+                       threads > 0 ? threads : std::thread::hardware_concurrency(),
+                       sweep_format >= 0 ? (sweep_format_t) sweep_format : SWEEP_CSV);
+    }
+
+    if (s_max >= 0) {
+        /* One pass over the trace for every associativity */
+        if (policy != REPL_LRU) {
+            fprintf(stderr, "cachesim: -a relies on the stack property of LRU\n");
+            exit(1);
+        }
+        uint64_t set_bits = c1 - b1 - s1;
+        cache_stats_t* sweep = (cache_stats_t*) calloc(s_max + 1, sizeof(cache_stats_t));
+        stack_sim = new StackDistance(b1, set_bits, s_max);
+        replay_trace(trace_path, stack_access, NULL);
+        stack_sim->complete(sweep);
+        delete stack_sim;
+        print_assoc_sweep(sweep, b1, set_bits, s_max);
+        free(sweep);
+        return 0;
+    }
+
     printf("Cache Settings\n");
     printf("c: %" PRIu64 "\n", c1);
     printf("b: %" PRIu64 "\n", b1);
     printf("s: %" PRIu64 "\n", s1);
+    if (policy != REPL_LRU)
+        printf("r: %s\n", replacement_name(policy));
     printf("\n");
 
+    if (num_levels > 1) {
+        levels[0].c = c1;
+        levels[0].b = b1;
+        levels[0].s = s1;
+        levels[0].hit_time = 2 + 0.2 * s1;
+        int k;
+        for (k = 0; k < num_levels; k++)
+            levels[k].policy = policy;
+        hierarchy_and_exit(trace_path, levels, num_levels, inclusion, log_mode, log_path);
+    }
+
+    if (victim_entries > 0)
+        victim_and_exit(trace_path, c1, b1, s1, policy, victim_entries, &prefetch, log_mode, log_path);
+
+    if (mshrs > 0)
+        mshr_and_exit(trace_path, c1, b1, s1, policy, mshrs, issue_interval);
+
+    if (sample_ratio > 0)
+        sample_and_exit(trace_path, c1, b1, s1, policy, sample_ratio);
+
+    if (classify)
+        classify_and_exit(trace_path, c1, b1, s1, policy, &prefetch, log_mode, log_path);
+
+    if (policy == REPL_OPT) {
+        /* OPT looks ahead, so the whole trace is loaded and indexed first */
+        mapped_trace_t trace;
+        if (trace_load(trace_path, &trace) != 0) {
+            fprintf(stderr, "cachesim: cannot load trace %s\n", trace_path != NULL ? trace_path : "from stdin");
+            exit(1);
+        }
+        FILE* log_out = open_hitmiss_log(log_mode, log_path);
+        cache_stats_t stats;
+        if (run_opt(&trace, c1, b1, s1, log_mode, log_out, &stats) != 0) {
+            fprintf(stderr, "cachesim: cannot create the next-use index\n");
+            exit(1);
+        }
+        if (log_out != stdout)
+            fclose(log_out);
+        trace_unmap(&trace);
+        print_statistics(&stats);
+        return 0;
+    }
+
+    if (threads > 1) {
+        /* One configuration split by set over several threads */
+        mapped_trace_t trace;
+        if (trace_load(trace_path, &trace) != 0) {
+            fprintf(stderr, "cachesim: cannot load trace %s\n", trace_path != NULL ? trace_path : "from stdin");
+            exit(1);
+        }
+        cache_stats_t stats;
+        run_sharded(&trace, c1, b1, s1, policy, threads, &stats);
+        trace_unmap(&trace);
+        print_statistics(&stats);
+        return 0;
+    }
+
     /* Setup the cache */
-    setup_cache(c1, b1, s1);
+    setup_cache(c1, b1, s1, policy);
+
+    /* Setup the hit/miss log */
+    FILE* log_out = open_hitmiss_log(log_mode, log_path);
+    set_hitmiss_log(log_mode, log_out);
+    set_prefetcher(&prefetch);
+    set_write_config(&write);
+    FILE* interval_out = NULL;
+    if (interval > 0) {
+        interval_out = open_interval_log(interval_path);
+        set_interval_log(interval, interval_out);
+    }
 
     /* Setup statistics */
     cache_stats_t stats;
     memset(&stats, 0, sizeof(cache_stats_t));
 
     /* Begin reading the file */
-    char rw;
-    uint64_t address;
-    while (!feof(stdin)) {
-        int ret = fscanf(stdin, "%c %" PRIx64 "\n", &rw, &address);
-        if(ret == 2) {
-            cache_access(rw, address, &stats);
-        }
-    }
+    if (histogram)
+        reuse = new ReuseDistance(b1);
+    replay_trace(trace_path, histogram ? reuse_access : cache_access, &stats);
 
     complete_cache(&stats);
+    if (log_out != stdout)
+        fclose(log_out);
+    if (interval_out != NULL && interval_out != stderr)
+        fclose(interval_out);
 
     print_statistics(&stats);
+    if (prefetch.kind != PREFETCH_NONE)
+        print_prefetch_statistics(&stats);
+    if (write_set)
+        print_write_statistics(&stats, &write);
+
+    if (histogram) {
+        reuse_histogram_t hist;
+        reuse->complete(&hist);
+        delete reuse;
+        print_reuse_histogram(&hist, b1);
+    }
 
     return 0;
 }
 
+/**
+ * Opens the stream the hit/miss log goes to: stdout for the text log, the
+ * -o file for the bits log
+ *
+ * @log_mode The log selected with -v
+ * @log_path The file given with -o or NULL
+ */
+FILE* open_hitmiss_log(hitmiss_log_t log_mode, const char* log_path) {
+    FILE* log_out = stdout;
+    if (log_mode == LOG_BITS) {
+        if (log_path == NULL || (log_out = fopen(log_path, "wb")) == NULL) {
+            fprintf(stderr, "cachesim: -v bits needs a writable -o FILE\n");
+            exit(1);
+        }
+    }
+    return log_out;
+}
+
+/**
+ * Opens the stream of the interval records, fully buffered since they come
+ * in a steady trickle
+ *
+ * @interval_path The file given with -I or NULL for stderr
+ */
+FILE* open_interval_log(const char* interval_path) {
+    FILE* interval_out = stderr;
+    if (interval_path != NULL && (interval_out = fopen(interval_path, "w")) == NULL) {
+        fprintf(stderr, "cachesim: cannot create %s\n", interval_path);
+        exit(1);
+    }
+    setvbuf(interval_out, NULL, _IOFBF, 1 << 16);
+    return interval_out;
+}
+
+/**
+ * Simulates an L1 with lower levels and prints the statistics of every level
+ *
+ * @trace_path The trace file or NULL for stdin
+ * @levels Geometry and hit time of each level, L1 first
+ * @num_levels Number of levels
+ * @inclusion Inclusion policy of the lower levels
+ * @log_mode The L1 hit/miss log selected with -v
+ * @log_path The file given with -o or NULL
+ */
+void hierarchy_and_exit(const char* trace_path, level_config_t* levels, int num_levels, inclusion_t inclusion,
+                        hitmiss_log_t log_mode, const char* log_path) {
+    int k;
+    for (k = 1; k < num_levels; k++) {
+        /* Lower levels may not have smaller blocks, exclusive ones need the same size */
+        if (levels[k].b < levels[k - 1].b || (inclusion == EXCLUSIVE && levels[k].b != levels[k - 1].b)) {
+            fprintf(stderr, "cachesim: L%d block size does not fit the inclusion policy\n", k + 1);
+            exit(1);
+        }
+        printf("L%d: c: %" PRIu64 " b: %" PRIu64 " s: %" PRIu64 " hit time: %.3f\n", k + 1, levels[k].c,
+               levels[k].b, levels[k].s, levels[k].hit_time);
+    }
+    printf("Inclusion: %s\n", inclusion == NINE ? "nine" : inclusion == INCLUSIVE ? "inclusive" : "exclusive");
+    printf("\n");
+
+    hierarchy = new Hierarchy(levels, num_levels, inclusion);
+    FILE* log_out = open_hitmiss_log(log_mode, log_path);
+    hierarchy->l1()->set_hitmiss_log(log_mode, log_out);
+
+    replay_trace(trace_path, hierarchy_access, NULL);
+
+    hierarchy_stats_t stats;
+    hierarchy->complete(&stats);
+    delete hierarchy;
+    if (log_out != stdout)
+        fclose(log_out);
+
+    print_statistics(&stats.level[0].cache);
+    print_hierarchy_statistics(&stats);
+    exit(0);
+}
+
+/**
+ * Simulates the L1 with a victim cache behind it and prints the L1
+ * statistics followed by those of the victim cache
+ *
+ * @trace_path The trace file or NULL for stdin
+ * @policy Replacement policy of the L1
+ * @entries Blocks in the victim cache
+ * @p_prefetch Prefetcher of the L1
+ * @log_mode The L1 hit/miss log selected with -v
+ * @log_path The file given with -o or NULL
+ */
+void victim_and_exit(const char* trace_path, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy,
+                     uint64_t entries, const prefetch_config_t* p_prefetch, hitmiss_log_t log_mode,
+                     const char* log_path) {
+    victim_cache = new VictimCache(c1, b1, s1, policy, entries);
+    victim_cache->l1()->set_prefetcher(p_prefetch);
+    FILE* log_out = open_hitmiss_log(log_mode, log_path);
+    victim_cache->l1()->set_hitmiss_log(log_mode, log_out);
+
+    replay_trace(trace_path, victim_access, NULL);
+
+    victim_cache_stats_t stats;
+    victim_cache->complete(&stats);
+    delete victim_cache;
+    if (log_out != stdout)
+        fclose(log_out);
+
+    print_statistics(&stats.l1);
+    if (p_prefetch->kind != PREFETCH_NONE)
+        print_prefetch_statistics(&stats.l1);
+    print_victim_statistics(&stats);
+    exit(0);
+}
+
+/**
+ * Simulates the L1 next to a fully associative shadow cache and prints the
+ * statistics followed by the 3C classification of the misses
+ *
+ * @trace_path The trace file or NULL for stdin
+ * @policy Replacement policy of the L1
+ * @p_prefetch Prefetcher of the L1
+ * @log_mode The hit/miss log selected with -v
+ * @log_path The file given with -o or NULL
+ */
+void classify_and_exit(const char* trace_path, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy,
+                       const prefetch_config_t* p_prefetch, hitmiss_log_t log_mode, const char* log_path) {
+    classified_cache = new Cache(c1, b1, s1, policy);
+    classified_cache->set_prefetcher(p_prefetch);
+    classifier = new MissClassifier(c1, b1);
+    FILE* log_out = open_hitmiss_log(log_mode, log_path);
+    classified_cache->set_hitmiss_log(log_mode, log_out);
+
+    replay_trace(trace_path, classified_access, NULL);
+
+    cache_stats_t stats;
+    miss_class_stats_t classes;
+    classified_cache->complete(&stats);
+    classifier->complete(&classes);
+    delete classified_cache;
+    delete classifier;
+    if (log_out != stdout)
+        fclose(log_out);
+
+    print_statistics(&stats);
+    if (p_prefetch->kind != PREFETCH_NONE)
+        print_prefetch_statistics(&stats);
+    print_miss_classification(&classes);
+    exit(0);
+}
+
+/**
+ * Times a non-blocking L1, prints the statistics and exits
+ *
+ * @trace_path The trace file or NULL for stdin
+ * @c1 The total number of bytes for data storage in L1 is 2^c
+ * @b1 The size of L1's blocks in bytes: 2^b-byte blocks.
+ * @s1 The number of blocks in each set of L1: 2^s blocks per set.
+ * @policy The replacement policy
+ * @mshrs The number of MSHRs
+ * @issue_interval Cycles between two accesses issuing
+ */
+void mshr_and_exit(const char* trace_path, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy, int mshrs,
+                   double issue_interval) {
+    mshr_timing = new MshrTiming(c1, b1, s1, policy, mshrs, issue_interval);
+    replay_trace(trace_path, mshr_access, NULL);
+
+    mshr_stats_t stats;
+    mshr_timing->complete(&stats);
+    delete mshr_timing;
+
+    print_statistics(&stats.l1);
+    print_mshr_statistics(&stats);
+    exit(0);
+}
+
+/**
+ * Estimates a single L1 from a sample of its sets, prints the statistics and exits
+ *
+ * @trace_path The trace file or NULL for stdin
+ * @c1 The total number of bytes for data storage in L1 is 2^c
+ * @b1 The size of L1's blocks in bytes: 2^b-byte blocks.
+ * @s1 The number of blocks in each set of L1: 2^s blocks per set.
+ * @policy The replacement policy
+ * @ratio One set in ratio is simulated
+ */
+void sample_and_exit(const char* trace_path, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy,
+                     uint64_t ratio) {
+    sampler = new SetSampler(c1, b1, s1, policy, ratio);
+    if (trace_path != NULL && trace_is_binary(trace_path)) {
+        //most accesses are skipped, so the record loop itself is the cost:
+        //decode straight into the inline set check rather than through replay_trace
+        mapped_trace_t trace;
+        if (trace_map(trace_path, &trace) != 0) {
+            fprintf(stderr, "cachesim: cannot map %s\n", trace_path);
+            exit(1);
+        }
+        uint64_t i;
+        for (i = 0; i < trace.count; i++)
+            sampler->access(trace_record_type(&trace, i), trace_record_address(&trace, i));
+        trace_unmap(&trace);
+    } else {
+        replay_trace(trace_path, sample_access, NULL);
+    }
+
+    set_sample_stats_t stats;
+    sampler->complete(&stats);
+    delete sampler;
+
+    print_statistics(&stats.estimate);
+    print_sample_statistics(&stats);
+    exit(0);
+}
+
+/**
+ * Parses a single value N or an inclusive range LO:HI
+ *
+ * @arg The option argument
+ * @p_lo Set to the low end of the range
+ * @p_hi Set to the high end of the range
+ */
+void parse_range(const char* arg, uint64_t* p_lo, uint64_t* p_hi) {
+    const char* colon = strchr(arg, ':');
+    *p_lo = atoi(arg);
+    *p_hi = colon != NULL ? atoi(colon + 1) : *p_lo;
+    if (*p_hi < *p_lo)
+        print_help_and_exit();
+}
+
+/**
+ * Loads the trace into memory once, simulates every valid configuration of
+ * the grid on a thread pool and prints one row per configuration
+ *
+ * @trace_path The trace file or NULL for stdin
+ * @policy Replacement policy of every configuration
+ * @threads Size of the thread pool
+ * @format Output format of the rows
+ */
+void sweep_and_exit(const char* trace_path, uint64_t c_lo, uint64_t c_hi, uint64_t b_lo, uint64_t b_hi,
+                    uint64_t s_lo, uint64_t s_hi, replacement_t policy, unsigned threads, sweep_format_t format) {
+    /* Every (c, b, s) with at least one set */
+    size_t max_points = (c_hi - c_lo + 1) * (b_hi - b_lo + 1) * (s_hi - s_lo + 1);
+    sweep_point_t* points = (sweep_point_t*) calloc(max_points, sizeof(sweep_point_t));
+    size_t num_points = 0;
+    uint64_t c, b, s;
+    for (c = c_lo; c <= c_hi; c++) {
+        for (b = b_lo; b <= b_hi; b++) {
+            for (s = s_lo; s <= s_hi; s++) {
+                if (b + s > c)
+                    continue;
+                points[num_points].c = c;
+                points[num_points].b = b;
+                points[num_points].s = s;
+                points[num_points].policy = policy;
+                num_points++;
+            }
+        }
+    }
+
+    mapped_trace_t trace;
+    if (trace_load(trace_path, &trace) != 0) {
+        fprintf(stderr, "cachesim: cannot load trace %s\n", trace_path != NULL ? trace_path : "from stdin");
+        exit(1);
+    }
+    run_sweep(&trace, points, num_points, threads);
+    trace_unmap(&trace);
+
+    print_sweep_header(stdout, format);
+    size_t i;
+    for (i = 0; i < num_points; i++) {
+        print_sweep_row(stdout, format, &points[i]);
+    }
+    free(points);
+    exit(0);
+}
+
+/**
+ * Feeds every access of the trace to access. The trace is read from
+ * trace_path if given, binary traces are mapped, and otherwise from stdin.
+ *
+ * @trace_path The trace file or NULL
+ * @access Called for every access
+ * @p_stats Pointer to the statistics structure, passed on to access
+ */
+void replay_trace(const char* trace_path, access_fn_t access, cache_stats_t* p_stats) {
+    if (trace_path != NULL && trace_is_binary(trace_path)) {
+        mapped_trace_t trace;
+        if (trace_map(trace_path, &trace) != 0) {
+            fprintf(stderr, "cachesim: cannot map %s\n", trace_path);
+            exit(1);
+        }
+        replay_binary_trace(&trace, access, p_stats);
+        trace_unmap(&trace);
+    } else if (trace_path != NULL && trace_is_compressed(trace_path)) {
+        mapped_trace_t trace;
+        if (trace_map_compressed(trace_path, &trace) != 0) {
+            fprintf(stderr, "cachesim: cannot map %s\n", trace_path);
+            exit(1);
+        }
+        replay_compressed_trace(&trace, access, p_stats);
+        trace_unmap(&trace);
+    } else if (trace_path != NULL) {
+        FILE* in = fopen(trace_path, "r");
+        if (in == NULL) {
+            fprintf(stderr, "cachesim: cannot open %s\n", trace_path);
+            exit(1);
+        }
+        replay_text_trace(in, access, p_stats);
+        fclose(in);
+    } else {
+        replay_text_trace(stdin, access, p_stats);
+    }
+}
+
+/** Accesses parsed per batch of the text trace pipeline */
+static const int TRACE_BATCH_ACCESSES = 4096;
+
+struct trace_batch_t {
+    int count;                  /* fewer than TRACE_BATCH_ACCESSES in the last batch only */
+    char types[TRACE_BATCH_ACCESSES];
+    uint64_t addresses[TRACE_BATCH_ACCESSES];
+};
+
+typedef SpscRing<trace_batch_t, 8> trace_ring_t;
+
+/**
+ * The parser side of the text trace pipeline: fills batches until the end of
+ * the stream, the last one is short (possibly empty)
+ *
+ * @in The trace stream
+ * @ring The ring the batches go through
+ */
+static void parse_text_batches(FILE* in, trace_ring_t* ring) {
+    bool last = false;
+    while (!last) {
+        trace_batch_t* batch = ring->write_slot();
+        batch->count = 0;
+        while (batch->count < TRACE_BATCH_ACCESSES && !feof(in)) {
+            char rw;
+            uint64_t address;
+            int ret = fscanf(in, "%c %" PRIx64 "\n", &rw, &address);
+            if(ret == 2) {
+                batch->types[batch->count] = rw;
+                batch->addresses[batch->count] = address;
+                batch->count++;
+            }
+        }
+        last = batch->count < TRACE_BATCH_ACCESSES;
+        ring->push();
+    }
+}
+
+/**
+ * Feeds every access of a text trace ("r 7fffe008" per line) to access. With
+ * more than one CPU a second thread parses the trace into batches that reach
+ * this one through a lock-free ring, so parsing overlaps the simulation.
+ *
+ * @in The trace stream
+ * @access Called for every access
+ * @p_stats Pointer to the statistics structure
+ */
+void replay_text_trace(FILE* in, access_fn_t access, cache_stats_t* p_stats) {
+    if (std::thread::hardware_concurrency() < 2) {
+        char rw;
+        uint64_t address;
+        while (!feof(in)) {
+            int ret = fscanf(in, "%c %" PRIx64 "\n", &rw, &address);
+            if(ret == 2) {
+                access(rw, address, p_stats);
+            }
+        }
+        return;
+    }
+
+    //the indices are cache-line aligned, which plain new does not guarantee
+    void* memory;
+    if (posix_memalign(&memory, 64, sizeof(trace_ring_t)) != 0)
+        abort();
+    trace_ring_t* ring = new (memory) trace_ring_t;
+    std::thread parser(parse_text_batches, in, ring);
+    bool last = false;
+    while (!last) {
+        const trace_batch_t* batch = ring->read_slot();
+        int i;
+        for (i = 0; i < batch->count; i++)
+            access(batch->types[i], batch->addresses[i], p_stats);
+        last = batch->count < TRACE_BATCH_ACCESSES;
+        ring->pop();
+    }
+    parser.join();
+    ring->~trace_ring_t();
+    free(memory);
+}
+
+/**
+ * Feeds every access of a mapped binary trace to access, decoding the
+ * records straight from the mapping
+ *
+ * @p_trace The mapped trace
+ * @access Called for every access
+ * @p_stats Pointer to the statistics structure
+ */
+void replay_binary_trace(const mapped_trace_t* p_trace, access_fn_t access, cache_stats_t* p_stats) {
+    uint64_t i;
+    for (i = 0; i < p_trace->count; i++) {
+        access(trace_record_type(p_trace, i), trace_record_address(p_trace, i), p_stats);
+    }
+}
+
+/**
+ * Feeds every access of a mapped compressed trace to access. Each block is
+ * decoded into one reused buffer of types and addresses and then replayed in
+ * a tight loop, so the varint decoding does not interleave with the
+ * simulation.
+ *
+ * @p_trace The mapped trace
+ * @access Called for every access
+ * @p_stats Pointer to the statistics structure
+ */
+void replay_compressed_trace(const mapped_trace_t* p_trace, access_fn_t access, cache_stats_t* p_stats) {
+    std::vector<char> types(TRACE_BLOCK_RECORDS);
+    std::vector<uint64_t> addresses(TRACE_BLOCK_RECORDS);
+    const unsigned char* p = p_trace->records;
+    const unsigned char* end = p_trace->base + p_trace->length;
+    while (p < end) {
+        uint32_t n = trace_decode_block(p, end, &types[0], &addresses[0], &p);
+        uint32_t i;
+        for (i = 0; i < n; i++)
+            access(types[i], addresses[i], p_stats);
+    }
+}
+
+/**
+ * Prints one line per associativity of a stack distance sweep
+ *
+ * @p_stats Array of s_max + 1 statistics structures
+ * @b1 The block size is 2^b1 bytes
+ * @set_bits The number of sets is 2^set_bits
+ * @s_max The largest associativity is 2^s_max
+ */
+void print_assoc_sweep(cache_stats_t* p_stats, uint64_t b1, uint64_t set_bits, uint64_t s_max) {
+    printf("Associativity Sweep\n");
+    printf("b: %" PRIu64 "\n", b1);
+    printf("sets: 2^%" PRIu64 "\n", set_bits);
+    printf("\n");
+    printf("%4s %4s %12s %12s %12s %12s %12s %12s %8s %8s\n", "c", "s", "accesses", "hits", "misses",
+           "read_misses", "write_misses", "write_backs", "miss", "AAT");
+    uint64_t s;
+    for (s = 0; s <= s_max; s++) {
+        cache_stats_t* p = &p_stats[s];
+        printf("%4" PRIu64 " %4" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+               " %12" PRIu64 " %8.3f %8.3f\n", b1 + set_bits + s, s, p->accesses, p->total_hits_l1,
+               p->total_misses_l1, p->read_misses_l1, p->write_misses_l1, p->write_back_l1,
+               p->total_miss_ratio, p->avg_access_time_l1);
+    }
+}
+
 void print_statistics(cache_stats_t* p_stats) {
     printf("Cache Statistics\n");
     printf("Accesses: %" PRIu64 "\n", p_stats->accesses);
@@ -102,3 +965,139 @@ void print_statistics(cache_stats_t* p_stats) {
     printf("Write miss ratio for L1: %.3f\n", p_stats->write_miss_ratio);
     printf("Average access time (AAT) for L1: %.3f\n", p_stats->avg_access_time_l1);
 }
+
+void print_hierarchy_statistics(hierarchy_stats_t* p_stats) {
+    int k;
+    for (k = 1; k < p_stats->num_levels; k++) {
+        level_stats_t* p = &p_stats->level[k];
+        printf("\n");
+        printf("L%d Statistics\n", k + 1);
+        printf("Accesses: %" PRIu64 "\n", p->cache.accesses);
+        printf("Reads (demand from L%d): %" PRIu64 "\n", k, p->cache.reads);
+        printf("Read hits to L%d: %" PRIu64 "\n", k + 1, p->cache.read_hits_l1);
+        printf("Read misses to L%d: %" PRIu64 "\n", k + 1, p->cache.read_misses_l1);
+        printf("Read miss ratio for L%d: %.3f\n", k + 1, p->cache.read_miss_ratio);
+        printf("Writes (write-backs from L%d): %" PRIu64 "\n", k, p->cache.writes);
+        printf("Write misses to L%d: %" PRIu64 "\n", k + 1, p->cache.write_misses_l1);
+        printf("Victims from L%d: %" PRIu64 "\n", k, p->victim_fills);
+        printf("Write backs from L%d: %" PRIu64 "\n", k + 1, p->write_backs);
+        printf("Back-invalidations by L%d: %" PRIu64 "\n", k + 1, p->back_invalidations);
+        printf("Hit time for L%d: %.3f\n", k + 1, p->hit_time);
+    }
+    printf("\n");
+    printf("Memory reads: %" PRIu64 "\n", p_stats->memory_reads);
+    printf("Memory writes: %" PRIu64 "\n", p_stats->memory_writes);
+    printf("Average access time (AAT) for the hierarchy: %.3f\n", p_stats->avg_access_time);
+}
+
+void print_miss_classification(miss_class_stats_t* p_stats) {
+    printf("\n");
+    printf("Miss classification\n");
+    printf("Compulsory read misses: %" PRIu64 "\n", p_stats->compulsory_reads);
+    printf("Compulsory write misses: %" PRIu64 "\n", p_stats->compulsory_writes);
+    printf("Capacity read misses: %" PRIu64 "\n", p_stats->capacity_reads);
+    printf("Capacity write misses: %" PRIu64 "\n", p_stats->capacity_writes);
+    printf("Conflict read misses: %" PRIu64 "\n", p_stats->conflict_reads);
+    printf("Conflict write misses: %" PRIu64 "\n", p_stats->conflict_writes);
+}
+
+void print_reuse_histogram(reuse_histogram_t* p_hist, uint64_t b1) {
+    printf("\n");
+    printf("Reuse Distance Histogram\n");
+    printf("b: %" PRIu64 "\n", b1);
+    printf("%24s %12s %8s\n", "distance", "accesses", "cum");
+    uint64_t cumulative = 0;
+    int d;
+    for (d = 0; d < REUSE_EXACT; d++) {
+        if (p_hist->exact[d] == 0)
+            continue;
+        cumulative += p_hist->exact[d];
+        printf("%24d %12" PRIu64 " %8.3f\n", d, p_hist->exact[d], cumulative / (double) p_hist->accesses);
+    }
+    int k;
+    for (k = 0; k < 64; k++) {
+        if (p_hist->log2[k] == 0)
+            continue;
+        char range[32];
+        snprintf(range, sizeof(range), "%" PRIu64 "-%" PRIu64, (uint64_t) 1 << k, ((uint64_t) 2 << k) - 1);
+        cumulative += p_hist->log2[k];
+        printf("%24s %12" PRIu64 " %8.3f\n", range, p_hist->log2[k], cumulative / (double) p_hist->accesses);
+    }
+    cumulative += p_hist->cold;
+    printf("%24s %12" PRIu64 " %8.3f\n", "cold", p_hist->cold, cumulative / (double) p_hist->accesses);
+}
+
+void print_prefetch_statistics(cache_stats_t* p_stats) {
+    printf("\n");
+    printf("Prefetch Statistics\n");
+    printf("Prefetches: %" PRIu64 "\n", p_stats->prefetches);
+    printf("Useful prefetches: %" PRIu64 "\n", p_stats->prefetch_useful);
+    printf("Late prefetches: %" PRIu64 "\n", p_stats->prefetch_late);
+    printf("Late prefetch stall cycles (in the AAT): %" PRIu64 "\n", p_stats->prefetch_late_cycles);
+    printf("Useless prefetches: %" PRIu64 "\n", p_stats->prefetch_useless);
+    printf("Misses caused by prefetch evictions: %" PRIu64 "\n", p_stats->prefetch_pollution);
+    printf("Prefetch accuracy: %.3f\n", p_stats->prefetch_accuracy);
+    printf("Prefetch coverage: %.3f\n", p_stats->prefetch_coverage);
+}
+
+void print_victim_statistics(victim_cache_stats_t* p_stats) {
+    printf("\n");
+    printf("Victim Cache Statistics\n");
+    printf("Entries: %" PRIu64 "\n", p_stats->entries);
+    printf("Probes (L1 misses): %" PRIu64 "\n", p_stats->probes);
+    printf("Victim hits: %" PRIu64 "\n", p_stats->hits);
+    printf("Dirty victim hits: %" PRIu64 "\n", p_stats->dirty_hits);
+    printf("Victim hit ratio: %.3f\n", p_stats->hit_ratio);
+    printf("Victim write backs: %" PRIu64 "\n", p_stats->write_backs);
+    printf("Average access time (AAT) with the victim cache: %.3f\n", p_stats->avg_access_time);
+}
+
+void print_write_statistics(cache_stats_t* p_stats, const write_config_t* p_write) {
+    printf("\n");
+    printf("Write Traffic\n");
+    printf("Write policy: %s\n", write_policy_name(p_write));
+    if (p_write->buffer_entries > 0) {
+        printf("Write buffer: %d blocks, one written out every %d accesses\n", p_write->buffer_entries,
+               p_write->drain_interval);
+        printf("Writes merged in the buffer: %" PRIu64 "\n", p_stats->write_buffer_merges);
+        printf("Writes stalled on a full buffer: %" PRIu64 "\n", p_stats->write_buffer_stalls);
+    }
+    printf("Block writes to the next level: %" PRIu64 "\n", p_stats->next_level_writes);
+    printf("Block writes per access: %.3f\n", p_stats->next_level_writes / (double) p_stats->accesses);
+}
+
+void print_sample_statistics(set_sample_stats_t* p_stats) {
+    printf("\n");
+    printf("Set Sampling (the statistics above are estimates)\n");
+    printf("Sampled sets: %" PRIu64 " of %" PRIu64 "\n", p_stats->sampled_sets, p_stats->sets);
+    printf("Simulated accesses: %" PRIu64 " of %" PRIu64 "\n", p_stats->sampled_accesses,
+           p_stats->estimate.accesses);
+    if (p_stats->miss_ratio_ci < 0) {
+        printf("Miss ratio: %.3f (one set sampled, no confidence interval)\n", p_stats->estimate.total_miss_ratio);
+        return;
+    }
+    printf("Miss ratio: %.3f +/- %.3f (95%% confidence)\n", p_stats->estimate.total_miss_ratio,
+           p_stats->miss_ratio_ci);
+    printf("Average access time (AAT): %.3f +/- %.3f (95%% confidence)\n", p_stats->estimate.avg_access_time_l1,
+           p_stats->avg_access_time_ci);
+}
+
+void print_mshr_statistics(mshr_stats_t* p_stats) {
+    printf("\n");
+    printf("Non-blocking Timing\n");
+    printf("MSHRs: %d\n", p_stats->mshrs);
+    printf("Issue interval: %.3f cycles\n", p_stats->issue_interval);
+    printf("Total cycles: %.0f\n", p_stats->cycles);
+    printf("Cycles per access: %.3f\n", p_stats->l1.accesses ? p_stats->cycles / p_stats->l1.accesses : 0);
+    printf("Primary misses: %" PRIu64 "\n", p_stats->primary_misses);
+    printf("Secondary misses (merged): %" PRIu64 "\n", p_stats->secondary_misses);
+    printf("MSHR full stalls: %" PRIu64 "\n", p_stats->stalls);
+    printf("Stall cycles: %.0f\n", p_stats->stall_cycles);
+    printf("Memory-level parallelism: %.3f\n", p_stats->mlp);
+    printf("%8s %14s %8s\n", "busy", "cycles", "frac");
+    int k;
+    for (k = 0; k <= p_stats->mshrs; k++) {
+        printf("%8d %14.0f %8.3f\n", k, p_stats->occupancy[k],
+               p_stats->cycles > 0 ? p_stats->occupancy[k] / p_stats->cycles : 0);
+    }
+}
@@ -0,0 +1,275 @@
+#include <cstdio>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Golden-output regression test, run by make test. Every reference output
+ * NAME_test*.out is replayed from DIR/NAME.trace with the configuration in
+ * its Cache Settings header and the graded H/M log, and the output of
+ * ./cachesim is compared with it: the settings, every H/M line, and the
+ * statistics block field by field. The wall time of each case is reported
+ * so that an optimization can be checked for being both exact and faster,
+ * against the time of a previous build with -p.
+ */
+
+/** Reference outputs whose NAME is not the name of their trace */
+struct trace_alias_t {
+    const char* name;               /* NAME of NAME_test*.out */
+    const char* trace;              /* the trace it was made from */
+};
+
+//perbench_test.out and perbench_test2.out are copies of perlbench_test.out
+//shipped under a misspelled name
+static const trace_alias_t trace_aliases[] = {
+    { "perbench", "perlbench" },
+};
+
+void print_help_and_exit(void) {
+    printf("cachesim_test [OPTIONS] NAME_test.out...\n");
+    printf("Replays DIR/NAME.trace for every reference output and compares the results\n");
+    printf("-h\t\tThis helpful output\n");
+    printf("-d DIR\t\tWhere the traces are (default traces), see the README for where to\n");
+    printf("\t\tget them\n");
+    printf("-p PROGRAM\tAlso time PROGRAM, e.g. a previous build of cachesim, on every case\n");
+    exit(0);
+}
+
+/** Reads a whole stream into lines, without the line ends */
+static void read_lines(FILE* in, std::vector<std::string>* p_lines) {
+    char line[256];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+        p_lines->push_back(line);
+    }
+}
+
+/**
+ * Runs cachesim with the trace on stdin and collects its output
+ *
+ * @program The cachesim binary
+ * @config The -c, -b and -s values
+ * @trace_path The trace, fed through stdin as in the graded runs
+ * @p_lines Set to the output lines
+ * @p_seconds Set to the wall time of the run
+ * @return 0 if cachesim ran and exited with 0
+ */
+static int run_cachesim(const char* program, const std::string config[3], const char* trace_path, std::vector<std::string>* p_lines,
+                        double* p_seconds) {
+    int out_pipe[2];
+    if (pipe(out_pipe) != 0)
+        return -1;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        if (freopen(trace_path, "r", stdin) == NULL)
+            _exit(127);
+        dup2(out_pipe[1], STDOUT_FILENO);
+        close(out_pipe[0]);
+        execl(program, program, "-c", config[0].c_str(), "-b", config[1].c_str(), "-s",
+              config[2].c_str(), "-v", "text", (char*) NULL);
+        _exit(127);
+    }
+    close(out_pipe[1]);
+    FILE* out = fdopen(out_pipe[0], "r");
+    read_lines(out, p_lines);
+    fclose(out);
+    int status;
+    waitpid(pid, &status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *p_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/** Index of the first line equal to text at or after from, or the number of lines */
+static size_t find_line(const std::vector<std::string>& lines, size_t from, const char* text) {
+    while (from < lines.size() && lines[from] != text)
+        from++;
+    return from;
+}
+
+/** Appends a printf-formatted line to a list of differences */
+static void add_diff(std::vector<std::string>* p_diffs, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void add_diff(std::vector<std::string>* p_diffs, const char* format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    p_diffs->push_back(line);
+}
+
+/**
+ * Compares one output with its reference
+ *
+ * @expected The reference output
+ * @actual The output of cachesim
+ * @p_diffs Set to a description of every difference, the H/M log ones capped
+ */
+static void compare(const std::vector<std::string>& expected, const std::vector<std::string>& actual,
+                    std::vector<std::string>* p_diffs) {
+    int log_diffs = 0;
+    size_t expected_stats = find_line(expected, 0, "Cache Statistics");
+    size_t actual_stats = find_line(actual, 0, "Cache Statistics");
+
+    //the settings header and the H/M log, line by line up to the statistics
+    size_t i;
+    for (i = 0; i < expected_stats || i < actual_stats; i++) {
+        const char* e = i < expected_stats ? expected[i].c_str() : "(none)";
+        const char* a = i < actual_stats ? actual[i].c_str() : "(none)";
+        if (strcmp(e, a) && log_diffs++ < 10)
+            add_diff(p_diffs, "line %zu: expected \"%s\", got \"%s\"", i + 1, e, a);
+    }
+    if (log_diffs > 10)
+        add_diff(p_diffs, "%d more lines differ", log_diffs - 10);
+
+    //the statistics, field by field
+    for (i = expected_stats + 1; i < expected.size(); i++) {
+        const std::string& e = expected[i];
+        size_t colon = e.find(':');
+        if (colon == std::string::npos)
+            continue;
+        std::string field = e.substr(0, colon + 1);
+        size_t j;
+        for (j = actual_stats + 1; j < actual.size(); j++) {
+            if (actual[j].compare(0, field.size(), field) == 0)
+                break;
+        }
+        if (j == actual.size())
+            add_diff(p_diffs, "%s missing", field.c_str());
+        else if (actual[j] != e)
+            add_diff(p_diffs, "%s expected%s, got%s", field.c_str(), e.c_str() + colon + 1,
+                     actual[j].c_str() + colon + 1);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    const char* dir = "traces";
+    const char* previous = NULL;
+
+    while(-1 != (opt = getopt(argc, argv, "d:p:h"))) {
+        switch(opt) {
+        case 'd':
+            dir = optarg;
+            break;
+        case 'p':
+            previous = optarg;
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    int passed = 0, failed = 0, skipped = 0;
+    double total_seconds = 0;
+    double total_previous = 0;
+    int k;
+    for (k = optind; k < argc; k++) {
+        const char* ref_path = argv[k];
+        const char* base = strrchr(ref_path, '/') != NULL ? strrchr(ref_path, '/') + 1 : ref_path;
+        const char* suffix = strstr(base, "_test");
+        if (suffix == NULL) {
+            printf("SKIP %s: not a NAME_test*.out file\n", ref_path);
+            skipped++;
+            continue;
+        }
+        std::string name(base, suffix - base);
+        size_t a;
+        for (a = 0; a < sizeof(trace_aliases) / sizeof(trace_aliases[0]); a++) {
+            if (name == trace_aliases[a].name) {
+                printf("NOTE %s: a misspelled %s reference, replayed from its trace\n", ref_path,
+                       trace_aliases[a].trace);
+                name = trace_aliases[a].trace;
+            }
+        }
+        std::string trace_path = std::string(dir) + "/" + name + ".trace";
+        if (access(trace_path.c_str(), R_OK) != 0) {
+            printf("SKIP %s: no %s\n", ref_path, trace_path.c_str());
+            skipped++;
+            continue;
+        }
+
+        std::vector<std::string> expected;
+        FILE* ref = fopen(ref_path, "r");
+        if (ref == NULL) {
+            printf("FAIL %s: cannot read it\n", ref_path);
+            failed++;
+            continue;
+        }
+        read_lines(ref, &expected);
+        fclose(ref);
+
+        //the configuration is in the "c: 12" lines of the settings header
+        std::string config[3];
+        const char* names[3] = { "c: ", "b: ", "s: " };
+        size_t i;
+        int n;
+        for (n = 0; n < 3; n++) {
+            for (i = 0; i < expected.size() && i < 8; i++) {
+                if (expected[i].compare(0, 3, names[n]) == 0)
+                    config[n] = expected[i].substr(3);
+            }
+        }
+        if (config[0].empty() || config[1].empty() || config[2].empty()) {
+            printf("FAIL %s: no c, b and s in the Cache Settings header\n", ref_path);
+            failed++;
+            continue;
+        }
+
+        std::vector<std::string> actual;
+        double seconds = 0;
+        if (run_cachesim("./cachesim", config, trace_path.c_str(), &actual, &seconds) != 0) {
+            printf("FAIL %s: ./cachesim did not run to completion\n", ref_path);
+            failed++;
+            continue;
+        }
+        total_seconds += seconds;
+        std::vector<std::string> diffs;
+        compare(expected, actual, &diffs);
+        printf("%s %s (c %s, b %s, s %s) %.3fs", diffs.empty() ? "PASS" : "FAIL", ref_path, config[0].c_str(),
+               config[1].c_str(), config[2].c_str(), seconds);
+        if (previous != NULL) {
+            std::vector<std::string> ignored;
+            double previous_seconds = 0;
+            if (run_cachesim(previous, config, trace_path.c_str(), &ignored, &previous_seconds) == 0) {
+                total_previous += previous_seconds;
+                printf(", %s %.3fs (%.2fx)", previous, previous_seconds, previous_seconds / seconds);
+            }
+        }
+        printf("\n");
+        for (i = 0; i < diffs.size(); i++)
+            printf("  %s\n", diffs[i].c_str());
+        fflush(stdout);
+        if (diffs.empty())
+            passed++;
+        else
+            failed++;
+    }
+
+    printf("%d passed, %d failed, %d skipped, %.3fs", passed, failed, skipped, total_seconds);
+    if (previous != NULL && total_seconds > 0)
+        printf(", %s %.3fs (%.2fx)", previous, total_previous, total_previous / total_seconds);
+    printf("\n");
+    if (passed == 0 && failed == 0) {
+        //nothing was checked, which must not look like a pass
+        fflush(stdout);
+        fprintf(stderr, "cachesim_test: no case was run, every trace is missing from %s; see the README\n", dir);
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,211 @@
+#include "hierarchy.hpp"
+#include <cstring>
+using namespace std;
+
+//miss penalty of memory behind the last level
+static const double MEMORY_PENALTY = 20;
+
+/**
+ * Sets up a cold hierarchy
+ *
+ * @levels Geometry and hit time of L1, L2, ...
+ * @num_levels Number of levels, 1 to MAX_LEVELS
+ * @inclusion Inclusion policy between all adjacent levels
+ */
+Hierarchy::Hierarchy(const level_config_t* levels, int num_levels, inclusion_t inclusion) {
+	this->num_levels = num_levels;
+	this->inclusion = inclusion;
+	int k;
+	for (k = 0; k < num_levels; k++) {
+		config[k] = levels[k];
+		caches[k] = new Cache(levels[k].c, levels[k].b, levels[k].s, levels[k].policy);
+	}
+	memset(write_backs, 0, sizeof(write_backs));
+	memset(back_invalidations, 0, sizeof(back_invalidations));
+	memset(victim_fills, 0, sizeof(victim_fills));
+	memory_reads = memory_writes = 0;
+}
+
+Hierarchy::~Hierarchy() {
+	int k;
+	for (k = 0; k < num_levels; k++) {
+		delete caches[k];
+	}
+}
+
+/**
+ * Simulates the hierarchy one trace event at a time
+ *
+ * @type The type of event, can be READ or WRITE.
+ * @arg  The target memory address
+ */
+void Hierarchy::access(char type, uint64_t arg) {
+	cache_victim_t victim;
+	bool hit = caches[0]->access(type, arg, &victim);
+
+	if (inclusion == EXCLUSIVE) {
+		//take the block out of the level below that has it, then move the
+		//L1 victim down into the space
+		if (!hit && probe(1, arg))
+			caches[0]->set_dirty(arg);
+		if (victim.valid) {
+			if (victim.dirty)
+				write_backs[0]++;
+			move_down(1, victim.address, victim.dirty);
+		}
+		return;
+	}
+
+	//the victim is written back before the fetch, so an inclusive L2 cannot
+	//drop it in between
+	if (victim.valid)
+		evicted(0, &victim);
+	if (!hit)
+		fetch(1, arg);
+}
+
+/**
+ * Demand read from level k after a miss in level k-1
+ *
+ * @k The level, num_levels is memory
+ * @arg The target memory address
+ */
+void Hierarchy::fetch(int k, uint64_t arg) {
+	if (k == num_levels) {
+		memory_reads++;
+		return;
+	}
+	cache_victim_t victim;
+	bool hit = caches[k]->access(READ, arg, &victim);
+	if (victim.valid)
+		evicted(k, &victim);
+	if (!hit)
+		fetch(k + 1, arg);
+}
+
+/**
+ * Write-back of a dirty block from level k-1 into level k. A miss allocates
+ * the block without fetching it, the whole block is being written.
+ *
+ * @k The level, num_levels is memory
+ * @arg The address of the block
+ */
+void Hierarchy::write_back(int k, uint64_t arg) {
+	if (k == num_levels) {
+		memory_writes++;
+		return;
+	}
+	cache_victim_t victim;
+	caches[k]->access(WRITE, arg, &victim);
+	if (victim.valid)
+		evicted(k, &victim);
+}
+
+/**
+ * Handles a block evicted from level k in a NINE or inclusive hierarchy.
+ * An inclusive level removes its copies above; a dirty copy up there holds
+ * newer data than level k, so it makes the eviction a write-back too.
+ *
+ * @k The level that evicted the block
+ * @p_victim The evicted block
+ */
+void Hierarchy::evicted(int k, const cache_victim_t* p_victim) {
+	bool dirty = p_victim->dirty;
+	if (inclusion == INCLUSIVE) {
+		int j;
+		for (j = 0; j < k; j++) {
+			//a level above may have smaller blocks, remove every one of them
+			uint64_t sub_blocks = (uint64_t) 1 << (config[k].b - config[j].b);
+			uint64_t n;
+			for (n = 0; n < sub_blocks; n++) {
+				bool sub_dirty;
+				if (caches[j]->invalidate(p_victim->address + (n << config[j].b), &sub_dirty)) {
+					back_invalidations[k]++;
+					dirty = dirty || sub_dirty;
+				}
+			}
+		}
+	}
+	if (dirty) {
+		write_backs[k]++;
+		write_back(k + 1, p_victim->address);
+	}
+}
+
+/**
+ * Exclusive hierarchy: looks for a block missing above in level k and below,
+ * removing it from the level that has it
+ *
+ * @k The level, num_levels is memory
+ * @arg The target memory address
+ * @return whether the block found was dirty
+ */
+bool Hierarchy::probe(int k, uint64_t arg) {
+	if (k == num_levels) {
+		memory_reads++;
+		return false;
+	}
+	bool dirty;
+	if (caches[k]->extract(arg, &dirty))
+		return dirty;
+	return probe(k + 1, arg);
+}
+
+/**
+ * Exclusive hierarchy: places a victim from level k-1 into level k, whose
+ * own victim moves further down
+ *
+ * @k The level, num_levels is memory
+ * @arg The address of the block
+ * @dirty The block is dirty
+ */
+void Hierarchy::move_down(int k, uint64_t arg, bool dirty) {
+	if (k == num_levels) {
+		if (dirty)
+			memory_writes++;
+		return;
+	}
+	cache_victim_t victim;
+	victim_fills[k]++;
+	caches[k]->insert(arg, dirty, &victim);
+	if (victim.valid) {
+		if (victim.dirty)
+			write_backs[k]++;
+		move_down(k + 1, victim.address, victim.dirty);
+	}
+}
+
+/**
+ * Calculates per-level statistics and the average access time of the whole
+ * hierarchy. A lower level's miss ratio in the AAT is that of its reads,
+ * the demand traffic from above; write-backs are off the critical path.
+ *
+ * @p_stats Pointer to the statistics structure
+ */
+void Hierarchy::complete(hierarchy_stats_t* p_stats) {
+	memset(p_stats, 0, sizeof(*p_stats));
+	p_stats->num_levels = num_levels;
+	int k;
+	for (k = 0; k < num_levels; k++) {
+		level_stats_t* p_level = &p_stats->level[k];
+		caches[k]->complete(&p_level->cache);
+		p_level->write_backs = write_backs[k];
+		p_level->back_invalidations = back_invalidations[k];
+		p_level->victim_fills = victim_fills[k];
+		p_level->hit_time = config[k].hit_time;
+	}
+	p_stats->memory_reads = memory_reads;
+	p_stats->memory_writes = memory_writes;
+
+	double time = MEMORY_PENALTY;
+	for (k = num_levels - 1; k >= 0; k--) {
+		const cache_stats_t* p = &p_stats->level[k].cache;
+		double MR;
+		if (k == 0)
+			MR = p->accesses ? p->total_misses_l1 / (double) p->accesses : 0;
+		else
+			MR = p->reads ? p->read_misses_l1 / (double) p->reads : 0;
+		time = config[k].hit_time + MR * time;
+	}
+	p_stats->avg_access_time = time;
+}
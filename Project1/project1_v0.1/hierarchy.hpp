@@ -0,0 +1,79 @@
+#ifndef HIERARCHY_HPP
+#define HIERARCHY_HPP
+
+#include "cachesim.hpp"
+
+/** Deepest hierarchy supported: L1, L2 and L3 */
+static const int MAX_LEVELS = 3;
+
+/** How the contents of a level relate to the levels above it */
+enum inclusion_t {
+    NINE,           /* non-inclusive non-exclusive: levels fill independently */
+    INCLUSIVE,      /* a lower level holds everything above it, its evictions back-invalidate */
+    EXCLUSIVE       /* a block lives in one level only, victims move down a level */
+};
+
+/** Geometry, replacement policy and hit time of one level */
+struct level_config_t {
+    uint64_t c;
+    uint64_t b;
+    uint64_t s;
+    replacement_t policy;
+    double hit_time;
+};
+
+/** Statistics of one level, see complete for what reads and writes mean */
+struct level_stats_t {
+    cache_stats_t cache;            /* lookups as counted by the level's cache */
+    uint64_t write_backs;           /* dirty blocks sent to the next level or memory */
+    uint64_t back_invalidations;    /* blocks removed above by this level's evictions */
+    uint64_t victim_fills;          /* victims placed here by the level above (exclusive) */
+    double hit_time;
+};
+
+struct hierarchy_stats_t {
+    int num_levels;
+    level_stats_t level[MAX_LEVELS];
+    uint64_t memory_reads;
+    uint64_t memory_writes;
+    double avg_access_time;         /* HT1 + MR1 * (HT2 + MR2 * (... + MRn * MP)) */
+};
+
+/*
+ * An L1 with up to two lower levels in front of memory. Every level is
+ * write-back, and a level that misses on a demand read fetches from the next
+ * one. Reads at a lower level are demand fetches from the level above and
+ * writes are write-backs from it (allocated without a fetch on a miss); in an
+ * exclusive hierarchy reads are the probes made by a miss above.
+ */
+class Hierarchy {
+public:
+    Hierarchy(const level_config_t* levels, int num_levels, inclusion_t inclusion);
+    ~Hierarchy();
+
+    void access(char type, uint64_t arg);
+    void complete(hierarchy_stats_t* p_stats);
+    /** The L1, e.g. to attach a hit/miss log */
+    Cache* l1() { return caches[0]; }
+
+private:
+    Hierarchy(const Hierarchy&);
+    Hierarchy& operator=(const Hierarchy&);
+
+    void fetch(int k, uint64_t arg);
+    void write_back(int k, uint64_t arg);
+    void evicted(int k, const cache_victim_t* p_victim);
+    bool probe(int k, uint64_t arg);
+    void move_down(int k, uint64_t arg, bool dirty);
+
+    int num_levels;
+    inclusion_t inclusion;
+    level_config_t config[MAX_LEVELS];
+    Cache* caches[MAX_LEVELS];
+    uint64_t write_backs[MAX_LEVELS];
+    uint64_t back_invalidations[MAX_LEVELS];
+    uint64_t victim_fills[MAX_LEVELS];
+    uint64_t memory_reads, memory_writes;
+};
+
+#endif /* HIERARCHY_HPP */
@@ -0,0 +1,101 @@
+#include <cstring>
+#include "miss_class.hpp"
+
+//map value of a block that was seen but is not in the shadow cache, also
+//the end of the LRU list
+static const uint64_t NOT_RESIDENT = UINT64_MAX;
+
+/**
+ * Sets up an empty shadow cache
+ *
+ * @c1 The total number of bytes for data storage is 2^c
+ * @b1 The size of the blocks in bytes: 2^b-byte blocks.
+ */
+MissClassifier::MissClassifier(uint64_t c1, uint64_t b1) {
+    block_bits = b1;
+    capacity = (uint64_t) 1 << (c1 - b1);
+    nodes.reserve(capacity);
+    head = tail = NOT_RESIDENT;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MissClassifier::unlink(uint64_t n) {
+    node_t* p = &nodes[n];
+    if (p->prev != NOT_RESIDENT)
+        nodes[p->prev].next = p->next;
+    else
+        head = p->next;
+    if (p->next != NOT_RESIDENT)
+        nodes[p->next].prev = p->prev;
+    else
+        tail = p->prev;
+}
+
+void MissClassifier::push_front(uint64_t n) {
+    nodes[n].prev = NOT_RESIDENT;
+    nodes[n].next = head;
+    if (head != NOT_RESIDENT)
+        nodes[head].prev = n;
+    head = n;
+    if (tail == NOT_RESIDENT)
+        tail = n;
+}
+
+/**
+ * Runs one access through the shadow cache and classifies it if the real
+ * cache missed
+ *
+ * @type The type of event, can be READ or WRITE.
+ * @arg  The target memory address
+ * @hit Whether the real cache hit
+ */
+void MissClassifier::access(char type, uint64_t arg, bool hit) {
+    uint64_t block = arg >> block_bits;
+    std::pair<std::unordered_map<uint64_t, uint64_t>::iterator, bool> found =
+        blocks.insert(std::make_pair(block, NOT_RESIDENT));
+    uint64_t n = found.first->second;
+    bool first_reference = found.second;
+    bool shadow_hit = n != NOT_RESIDENT;
+
+    if (!hit) {
+        uint64_t* counter;
+        if (first_reference)
+            counter = type == READ ? &stats.compulsory_reads : &stats.compulsory_writes;
+        else if (!shadow_hit)
+            counter = type == READ ? &stats.capacity_reads : &stats.capacity_writes;
+        else
+            counter = type == READ ? &stats.conflict_reads : &stats.conflict_writes;
+        (*counter)++;
+    }
+
+    if (shadow_hit) {
+        //move to the MRU end
+        if (n != head) {
+            unlink(n);
+            push_front(n);
+        }
+        return;
+    }
+
+    if (nodes.size() < capacity) {
+        n = nodes.size();
+        nodes.push_back(node_t());
+    } else {
+        //evict the LRU block and reuse its node
+        n = tail;
+        unlink(n);
+        blocks[nodes[n].block] = NOT_RESIDENT;
+    }
+    nodes[n].block = block;
+    push_front(n);
+    found.first->second = n;
+}
+
+/**
+ * Copies out the classification
+ *
+ * @p_stats Pointer to the classification counters
+ */
+void MissClassifier::complete(miss_class_stats_t* p_stats) {
+    *p_stats = stats;
+}
@@ -0,0 +1,53 @@
+#ifndef MISS_CLASS_HPP
+#define MISS_CLASS_HPP
+
+#include <unordered_map>
+#include <vector>
+#include "cachesim.hpp"
+
+/** Misses of the real cache split into the 3Cs, each by access type */
+struct miss_class_stats_t {
+    uint64_t compulsory_reads;      /* first reference to the block */
+    uint64_t compulsory_writes;
+    uint64_t capacity_reads;        /* a fully associative LRU cache of the same size misses too */
+    uint64_t capacity_writes;
+    uint64_t conflict_reads;        /* the fully associative cache hits */
+    uint64_t conflict_writes;
+};
+
+/*
+ * Classifies the misses of a cache by running a fully associative LRU shadow
+ * cache of the same capacity and block size next to it. The shadow is a hash
+ * map from block to its node in an intrusive doubly linked LRU list, so an
+ * access costs one hash lookup whatever the capacity. Blocks that leave the
+ * shadow stay in the map marked not resident, which makes it the seen-block
+ * set as well.
+ */
+class MissClassifier {
+public:
+    MissClassifier(uint64_t c1, uint64_t b1);
+
+    /** Records one access and, if the real cache missed (hit is false), classifies the miss */
+    void access(char type, uint64_t arg, bool hit);
+    void complete(miss_class_stats_t* p_stats);
+
+private:
+    /** One resident block of the shadow cache */
+    struct node_t {
+        uint64_t block;
+        uint64_t prev;              /* towards the MRU end */
+        uint64_t next;              /* towards the LRU end */
+    };
+
+    void unlink(uint64_t n);
+    void push_front(uint64_t n);
+
+    int block_bits;
+    uint64_t capacity;              /* blocks in the shadow cache */
+    std::unordered_map<uint64_t, uint64_t> blocks;  /* block -> node or NOT_RESIDENT */
+    std::vector<node_t> nodes;      /* in use: 0 .. nodes.size()-1 */
+    uint64_t head, tail;            /* MRU and LRU nodes */
+    miss_class_stats_t stats;
+};
+
+#endif /* MISS_CLASS_HPP */
@@ -0,0 +1,136 @@
+#include <cstring>
+#include "mshr.hpp"
+using namespace std;
+
+//miss penalty of memory behind the L1, as in calculate_ratios
+static const double MEMORY_PENALTY = 20;
+
+/**
+ * Sets up a cold L1 with idle MSHRs
+ *
+ * @c1 The total number of bytes for data storage in L1 is 2^c
+ * @b1 The size of L1's blocks in bytes: 2^b-byte blocks.
+ * @s1 The number of blocks in each set of L1: 2^s blocks per set.
+ * @policy Replacement policy of the L1
+ * @mshrs The number of MSHRs, at most MSHR_MAX
+ * @issue_interval Cycles between two accesses issuing
+ */
+MshrTiming::MshrTiming(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy, int mshrs,
+                       double issue_interval) {
+	cache = new Cache(c1, b1, s1, policy);
+	block_shift = b1;
+	hit_time = 2 + 0.2 * s1;
+	miss_time = hit_time + MEMORY_PENALTY;
+	memset(&stats, 0, sizeof(stats));
+	stats.mshrs = mshrs;
+	stats.issue_interval = issue_interval;
+	//the first access issues at cycle 0
+	now = -issue_interval;
+	accounted = 0;
+	last_done = 0;
+	busy = 0;
+}
+
+MshrTiming::~MshrTiming() {
+	delete cache;
+}
+
+/**
+ * Moves the occupancy histogram forward to a cycle, freeing the MSHRs whose
+ * block has arrived by then in the order they free
+ *
+ * @until The cycle to account up to
+ */
+void MshrTiming::advance(double until) {
+	while (busy > 0) {
+		int first = 0;
+		int i;
+		for (i = 1; i < busy; i++) {
+			if (done[i] < done[first])
+				first = i;
+		}
+		if (done[first] > until)
+			break;
+		if (done[first] > accounted) {
+			stats.occupancy[busy] += done[first] - accounted;
+			accounted = done[first];
+		}
+		//keep the busy entries packed at the front
+		busy--;
+		blocks[first] = blocks[busy];
+		done[first] = done[busy];
+	}
+	if (until > accounted) {
+		stats.occupancy[busy] += until - accounted;
+		accounted = until;
+	}
+}
+
+/**
+ * Issues one trace event
+ *
+ * @type The type of event, can be READ or WRITE.
+ * @arg  The target memory address
+ */
+void MshrTiming::access(char type, uint64_t arg) {
+	now += stats.issue_interval;
+	advance(now);
+
+	uint64_t block = arg >> block_shift;
+	cache_victim_t victim;
+	bool hit = cache->access(type, arg, &victim);
+
+	int i;
+	for (i = 0; i < busy; i++) {
+		if (blocks[i] == block) {
+			//the block is still on its way, wait for it with the first miss
+			stats.secondary_misses++;
+			return;
+		}
+	}
+	if (hit) {
+		if (now + hit_time > last_done)
+			last_done = now + hit_time;
+		return;
+	}
+
+	if (busy == stats.mshrs) {
+		//hold up issue until the first MSHR frees
+		double first = done[0];
+		for (i = 1; i < busy; i++) {
+			if (done[i] < first)
+				first = done[i];
+		}
+		stats.stalls++;
+		stats.stall_cycles += first - now;
+		now = first;
+		advance(now);
+	}
+	stats.primary_misses++;
+	blocks[busy] = block;
+	done[busy] = now + miss_time;
+	busy++;
+	if (now + miss_time > last_done)
+		last_done = now + miss_time;
+}
+
+/**
+ * Drains the outstanding misses and calculates the statistics
+ *
+ * @p_stats Pointer to the statistics structure
+ */
+void MshrTiming::complete(mshr_stats_t* p_stats) {
+	advance(last_done);
+	cache->complete(&stats.l1);
+	stats.cycles = last_done;
+
+	double busy_cycles = 0;
+	double busy_sum = 0;
+	int k;
+	for (k = 1; k <= stats.mshrs; k++) {
+		busy_cycles += stats.occupancy[k];
+		busy_sum += k * stats.occupancy[k];
+	}
+	stats.mlp = busy_cycles > 0 ? busy_sum / busy_cycles : 0;
+	*p_stats = stats;
+}
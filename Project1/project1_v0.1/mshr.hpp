@@ -0,0 +1,58 @@
+#ifndef MSHR_HPP
+#define MSHR_HPP
+
+#include "cachesim.hpp"
+
+/** Largest number of MSHRs */
+static const int MSHR_MAX = 64;
+
+struct mshr_stats_t {
+    cache_stats_t l1;               /* the L1 as usual, its AAT is the closed form */
+    int mshrs;
+    double issue_interval;          /* cycles between two accesses issuing */
+    double cycles;                  /* from the first issue to the last completion */
+    uint64_t primary_misses;        /* misses that allocated an MSHR */
+    uint64_t secondary_misses;      /* accesses merged into the MSHR of their block */
+    uint64_t stalls;                /* misses that found every MSHR busy */
+    double stall_cycles;            /* cycles issue was held back by them */
+    double mlp;                     /* mean busy MSHRs over the cycles with at least one busy */
+    double occupancy[MSHR_MAX + 1]; /* cycles spent with k MSHRs busy */
+};
+
+/*
+ * A non-blocking L1 timing model. An access issues every issue_interval
+ * cycles and a hit completes HT cycles later. A miss takes an MSHR until the
+ * block arrives after HT + MP cycles; further accesses to that block in the
+ * meantime merge into the MSHR and complete with it, whatever the tag array
+ * says. A miss that finds no free MSHR holds up issue until the first one
+ * frees. The tags and replacement are updated at issue, and write-backs are
+ * assumed to drain through a write buffer without taking an MSHR.
+ */
+class MshrTiming {
+public:
+    MshrTiming(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy, int mshrs, double issue_interval);
+    ~MshrTiming();
+
+    void access(char type, uint64_t arg);
+    void complete(mshr_stats_t* p_stats);
+
+private:
+    MshrTiming(const MshrTiming&);
+    MshrTiming& operator=(const MshrTiming&);
+
+    void advance(double until);
+
+    Cache* cache;
+    int block_shift;
+    double hit_time;
+    double miss_time;
+    mshr_stats_t stats;
+    double now;                     /* issue cycle of the current access */
+    double accounted;               /* the occupancy histogram is complete up to here */
+    double last_done;               /* latest completion so far */
+    int busy;
+    uint64_t blocks[MSHR_MAX];      /* block of busy MSHR i */
+    double done[MSHR_MAX];          /* the cycle busy MSHR i frees */
+};
+
+#endif /* MSHR_HPP */
@@ -0,0 +1,100 @@
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "opt.hpp"
+
+/**
+ * Subroutine for building the next-use index of a trace
+ *
+ * @p_trace The trace
+ * @b1 The size of the blocks in bytes: 2^b-byte blocks.
+ * @p_index Filled in with the mapped index on success
+ */
+int build_next_use(const mapped_trace_t* p_trace, uint64_t b1, next_use_index_t* p_index) {
+    memset(p_index, 0, sizeof(*p_index));
+    const char* dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/cachesim-opt-XXXXXX", dir != NULL ? dir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+    //the file is only reachable through the mapping from here on
+    unlink(path);
+
+    size_t length = (p_trace->count > 0 ? p_trace->count : 1) * sizeof(uint64_t);
+    if (ftruncate(fd, length) != 0) {
+        close(fd);
+        return -1;
+    }
+    void* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return -1;
+
+    //backward scan: the last position seen for a block is its next use
+    uint64_t* next = (uint64_t*) base;
+    std::unordered_map<uint64_t, uint64_t> last_seen;
+    uint64_t i = p_trace->count;
+    while (i-- > 0) {
+        uint64_t block = trace_record_address(p_trace, i) >> b1;
+        std::pair<std::unordered_map<uint64_t, uint64_t>::iterator, bool> seen =
+            last_seen.insert(std::make_pair(block, i));
+        if (seen.second) {
+            next[i] = NEXT_USE_NEVER;
+        } else {
+            next[i] = seen.first->second;
+            seen.first->second = i;
+        }
+    }
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    p_index->next = next;
+    p_index->count = p_trace->count;
+    p_index->length = length;
+    return 0;
+}
+
+/**
+ * Subroutine for releasing an index made by build_next_use, which also
+ * frees the temporary file
+ *
+ * @p_index The index
+ */
+void release_next_use(next_use_index_t* p_index) {
+    if (p_index->next != NULL)
+        munmap((void*) p_index->next, p_index->length);
+    memset(p_index, 0, sizeof(*p_index));
+}
+
+/**
+ * Subroutine for running one configuration under OPT
+ *
+ * @p_trace The trace
+ * @c1 The total number of bytes for data storage in L1 is 2^c
+ * @b1 The size of L1's blocks in bytes: 2^b-byte blocks.
+ * @s1 The number of blocks in each set of L1: 2^s blocks per set.
+ * @log_mode The hit/miss log
+ * @log_out The stream the log is written to
+ * @p_stats Pointer to the statistics structure
+ */
+int run_opt(const mapped_trace_t* p_trace, uint64_t c1, uint64_t b1, uint64_t s1, hitmiss_log_t log_mode,
+            FILE* log_out, cache_stats_t* p_stats) {
+    next_use_index_t index;
+    if (build_next_use(p_trace, b1, &index) != 0)
+        return -1;
+
+    Cache cache(c1, b1, s1, REPL_OPT);
+    cache.set_hitmiss_log(log_mode, log_out);
+    uint64_t i;
+    for (i = 0; i < p_trace->count; i++) {
+        cache.set_next_use(index.next[i]);
+        cache.access(trace_record_type(p_trace, i), trace_record_address(p_trace, i));
+    }
+    cache.complete(p_stats);
+
+    release_next_use(&index);
+    return 0;
+}
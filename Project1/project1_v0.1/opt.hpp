@@ -0,0 +1,39 @@
+#ifndef OPT_HPP
+#define OPT_HPP
+
+#include "cachesim.hpp"
+#include "trace.hpp"
+
+/** Next-use position of an access whose block is never used again */
+static const uint64_t NEXT_USE_NEVER = UINT64_MAX;
+
+/**
+ * For every access i of a trace, the position of the next access to the same
+ * block, or NEXT_USE_NEVER. The array lives in an unlinked temporary file
+ * mapped shared, so for traces larger than RAM the kernel writes it out
+ * during the backward pass and reads it back ahead of the simulation.
+ */
+struct next_use_index_t {
+    const uint64_t* next;
+    uint64_t count;
+    size_t length;              /* bytes mapped */
+};
+
+/**
+ * Builds the index of a trace for 2^b1-byte blocks with one backward scan
+ * and a hash map from block to the last position seen. The file is created
+ * in $TMPDIR (default /tmp). Returns 0 on success and -1 on error.
+ */
+int build_next_use(const mapped_trace_t* p_trace, uint64_t b1, next_use_index_t* p_index);
+void release_next_use(next_use_index_t* p_index);
+
+/**
+ * Simulates one configuration under Belady's OPT: on a miss to a full set
+ * the block used again furthest in the future is evicted. The log settings
+ * are those of set_hitmiss_log. Returns 0 on success and -1 if the index
+ * cannot be built.
+ */
+int run_opt(const mapped_trace_t* p_trace, uint64_t c1, uint64_t b1, uint64_t s1, hitmiss_log_t log_mode,
+            FILE* log_out, cache_stats_t* p_stats);
+
+#endif /* OPT_HPP */
@@ -0,0 +1,158 @@
+#include <cstdlib>
+#include <cstring>
+#include "prefetch.hpp"
+
+//-p names, in prefetch_kind_t order
+static const char* const PREFETCH_NAMES[] = { "none", "next-line", "stride", "stream" };
+
+//stride detectors track 2^12-byte regions
+static const int STRIDE_REGION_BITS = 12;
+//a stride is used once it has repeated this many times in a row
+static const int STRIDE_CONFIDENT = 2;
+static const int STRIDE_MAX_CONFIDENCE = 3;
+//a miss this many blocks from the last one of a stream continues it
+static const int64_t STREAM_WINDOW = 4;
+
+/**
+ * Parses the argument of -p
+ *
+ * @arg none, next-line, stride or stream, optionally followed by ,DEGREE and ,DISTANCE
+ * @p_config Set to the prefetcher configuration, degree and distance default to 1
+ */
+int parse_prefetch(const char* arg, prefetch_config_t* p_config) {
+	p_config->degree = 1;
+	p_config->distance = 1;
+	size_t name_len = strcspn(arg, ",");
+	int i;
+	for (i = 0; i <= PREFETCH_STREAM; i++) {
+		if (strlen(PREFETCH_NAMES[i]) == name_len && !strncmp(arg, PREFETCH_NAMES[i], name_len))
+			break;
+	}
+	if (i > PREFETCH_STREAM)
+		return -1;
+	p_config->kind = (prefetch_kind_t) i;
+	if (arg[name_len] == ',') {
+		const char* rest = arg + name_len + 1;
+		p_config->degree = atoi(rest);
+		const char* comma = strchr(rest, ',');
+		if (comma != NULL)
+			p_config->distance = atoi(comma + 1);
+	}
+	if (p_config->degree < 1 || p_config->degree > PREFETCH_MAX_DEGREE || p_config->distance < 1)
+		return -1;
+	return 0;
+}
+
+const char* prefetch_name(prefetch_kind_t kind) {
+	return PREFETCH_NAMES[kind];
+}
+
+/**
+ * Sets up an untrained prefetcher
+ *
+ * @config Kind, degree and distance
+ * @b1 The size of the blocks in bytes: 2^b-byte blocks.
+ */
+Prefetcher::Prefetcher(const prefetch_config_t& config, uint64_t b1) {
+	this->config = config;
+	region_shift = b1 < (uint64_t) STRIDE_REGION_BITS ? STRIDE_REGION_BITS - b1 : 0;
+	memset(strides, 0, sizeof(strides));
+	memset(streams, 0, sizeof(streams));
+	clock = 0;
+}
+
+/**
+ * Writes the degree blocks starting distance steps past block
+ */
+int Prefetcher::ahead(uint64_t block, int64_t step, uint64_t* blocks) {
+	int i;
+	for (i = 0; i < config.degree; i++)
+		blocks[i] = block + step * (config.distance + i);
+	return config.degree;
+}
+
+/**
+ * Trains on one demand access and asks for blocks
+ *
+ * @block The block number accessed
+ * @miss The access missed
+ * @first_use The access hit a prefetched block for the first time
+ * @blocks Set to the block numbers to prefetch
+ */
+int Prefetcher::access(uint64_t block, bool miss, bool first_use, uint64_t* blocks) {
+	clock++;
+	switch (config.kind) {
+	case PREFETCH_NEXT_LINE:
+		if (miss || first_use)
+			return ahead(block, 1, blocks);
+		return 0;
+
+	case PREFETCH_STRIDE: {
+		uint64_t region = block >> region_shift;
+		stride_entry_t* e = &strides[region % 64];
+		if (e->region != region) {
+			e->region = region;
+			e->last_block = block;
+			e->stride = 0;
+			e->confidence = 0;
+			return 0;
+		}
+		int64_t delta = (int64_t) (block - e->last_block);
+		e->last_block = block;
+		if (delta == 0)
+			return 0;
+		if (delta == e->stride) {
+			if (e->confidence < STRIDE_MAX_CONFIDENCE)
+				e->confidence++;
+		} else {
+			e->stride = delta;
+			e->confidence = 0;
+		}
+		if (e->confidence >= STRIDE_CONFIDENT)
+			return ahead(block, e->stride, blocks);
+		return 0;
+	}
+
+	case PREFETCH_STREAM: {
+		if (!miss && !first_use)
+			return 0;
+		//a stream whose next block is within the window continues
+		int i;
+		for (i = 0; i < 8; i++) {
+			stream_entry_t* s = &streams[i];
+			int64_t offset = (int64_t) (block - s->next_block) * s->direction;
+			if (s->valid && offset >= 0 && offset < STREAM_WINDOW) {
+				s->next_block = block + s->direction;
+				s->last_use = clock;
+				return ahead(block, s->direction, blocks);
+			}
+		}
+		if (!miss)
+			return 0;
+		//a miss just below the one that started an ascending stream turns it around
+		for (i = 0; i < 8; i++) {
+			stream_entry_t* s = &streams[i];
+			if (s->valid && s->direction == 1 && s->next_block == block + 2) {
+				s->next_block = block - 1;
+				s->direction = -1;
+				s->last_use = clock;
+				return ahead(block, -1, blocks);
+			}
+		}
+		//otherwise the least recently used tracker starts following this miss upwards
+		int lru = 0;
+		for (i = 1; i < 8; i++) {
+			if (!streams[i].valid || (streams[lru].valid && streams[i].last_use < streams[lru].last_use))
+				lru = i;
+		}
+		streams[lru].valid = true;
+		streams[lru].next_block = block + 1;
+		streams[lru].direction = 1;
+		streams[lru].last_use = clock;
+		return 0;
+	}
+
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,81 @@
+#ifndef PREFETCH_HPP
+#define PREFETCH_HPP
+
+#include <cstdint>
+
+/** Prefetchers selectable with -p */
+enum prefetch_kind_t {
+    PREFETCH_NONE,
+    PREFETCH_NEXT_LINE,     /* tagged next-line: on a miss or the first use of a prefetched block */
+    PREFETCH_STRIDE,        /* PC-less stride, one delta detector per 4KB region */
+    PREFETCH_STREAM         /* stream detection: 8 trackers of ascending or descending miss
+                               streams, prefetching into the cache (no separate buffers) */
+};
+
+/** Largest degree, i.e. blocks requested per trigger */
+static const int PREFETCH_MAX_DEGREE = 16;
+
+/**
+ * A demand hit on a prefetched block fewer than this many accesses after the
+ * prefetch is counted as late: the block would still be on its way from
+ * memory (the miss penalty in cycles, at roughly one access per cycle). It
+ * stays a hit, but the cycles left of the fill are added to the AAT.
+ */
+static const uint64_t PREFETCH_LATENCY = 20;
+
+struct prefetch_config_t {
+    prefetch_kind_t kind;
+    int degree;             /* blocks requested per trigger */
+    int distance;           /* how many blocks (or strides) ahead the first one is */
+};
+
+/** Parses KIND[,DEGREE[,DISTANCE]] as taken by -p, returns 0 on success and -1 on error */
+int parse_prefetch(const char* arg, prefetch_config_t* p_config);
+const char* prefetch_name(prefetch_kind_t kind);
+
+/*
+ * The address-pattern side of a prefetcher. It only sees demand accesses, in
+ * block numbers, and answers with the blocks to bring in; the cache does the
+ * fills and the accounting.
+ */
+class Prefetcher {
+public:
+    Prefetcher(const prefetch_config_t& config, uint64_t b1);
+
+    /**
+     * Trains on one demand access and returns the number of blocks written
+     * to blocks (at most PREFETCH_MAX_DEGREE)
+     *
+     * @block The block number accessed
+     * @miss The access missed
+     * @first_use The access hit a prefetched block for the first time
+     */
+    int access(uint64_t block, bool miss, bool first_use, uint64_t* blocks);
+
+private:
+    /** Stride detector of one region */
+    struct stride_entry_t {
+        uint64_t region;
+        uint64_t last_block;
+        int64_t stride;
+        int confidence;
+    };
+
+    /** A stream tracker: the next block it expects and the direction */
+    struct stream_entry_t {
+        bool valid;
+        uint64_t next_block;
+        int64_t direction;
+        uint64_t last_use;
+    };
+
+    int ahead(uint64_t block, int64_t step, uint64_t* blocks);
+
+    prefetch_config_t config;
+    int region_shift;               /* block number to region number */
+    stride_entry_t strides[64];
+    stream_entry_t streams[8];
+    uint64_t clock;
+};
+
+#endif /* PREFETCH_HPP */
@@ -0,0 +1,106 @@
+#include "replacement.hpp"
+#include <cstdlib>
+#include <cstring>
+
+//-r names, in replacement_t order
+static const char* const REPLACEMENT_NAMES[REPL_NUM_POLICIES] = {
+	"lru", "tree-plru", "bit-plru", "srrip", "brrip", "fifo", "random", "lfu", "opt"
+};
+
+/**
+ * Allocates and clears the replacement state of a cold cache
+ *
+ * @r The state to set up
+ * @policy The policy the cache runs
+ * @set_bits There are 2^set_bits sets
+ * @way_bits There are 2^way_bits ways per set
+ */
+void replacement_init(replacement_state_t* r, replacement_t policy, int set_bits, int way_bits) {
+	memset(r, 0, sizeof(*r));
+	r->ways = 1 << way_bits;
+	r->way_bits = way_bits;
+	//enough bits per set for a tree of ways-1 nodes numbered from 1, or one bit per way
+	r->set_words = (r->ways + 63) / 64;
+	r->search = select_way_search(r->ways);
+	r->set_stride = 1;
+
+	uint64_t num_sets = (uint64_t) 1 << set_bits;
+	if (policy == REPL_RANDOM || policy == REPL_BRRIP) {
+		r->draws = (uint32_t*) calloc(num_sets, sizeof(uint32_t));
+		if (r->draws == NULL)
+			abort();
+	}
+	uint64_t num_blocks = num_sets * r->ways;
+	size_t bytes = 0;
+	switch (policy) {
+	case REPL_LRU:
+	case REPL_OPT:
+		bytes = num_blocks * sizeof(uint64_t);
+		break;
+	case REPL_TREE_PLRU:
+	case REPL_BIT_PLRU:
+		bytes = num_sets * r->set_words * sizeof(uint64_t);
+		break;
+	case REPL_SRRIP:
+	case REPL_BRRIP:
+		bytes = num_blocks * sizeof(uint8_t);
+		break;
+	case REPL_FIFO:
+		bytes = num_sets * sizeof(uint32_t);
+		break;
+	case REPL_LFU:
+		bytes = num_blocks * sizeof(uint32_t);
+		break;
+	default:
+		break;
+	}
+	if (bytes == 0)
+		return;
+	if (posix_memalign(&r->storage, 64, bytes) != 0)
+		abort();
+	memset(r->storage, 0, bytes);
+	r->stamps = (uint64_t*) r->storage;
+	r->bits = (uint64_t*) r->storage;
+	r->rrpv = (uint8_t*) r->storage;
+	r->counts = (uint32_t*) r->storage;
+}
+
+void replacement_free(replacement_state_t* r) {
+	free(r->storage);
+	free(r->draws);
+	r->storage = NULL;
+	r->draws = NULL;
+}
+
+/**
+ * Renumbers the sets for the random draws, see replacement.hpp
+ *
+ * @r The state of the smaller cache
+ * @stride Set n of it is set n * stride + offset of the larger cache
+ * @offset See stride
+ */
+void replacement_set_numbering(replacement_state_t* r, uint64_t stride, uint64_t offset) {
+	r->set_stride = stride;
+	r->set_offset = offset;
+}
+
+/**
+ * Looks a policy up by the name -r takes
+ *
+ * @name lru, tree-plru, bit-plru, srrip, brrip, fifo, random, lfu or opt
+ * @p_policy Set to the policy
+ */
+int parse_replacement(const char* name, replacement_t* p_policy) {
+	int i;
+	for (i = 0; i < REPL_NUM_POLICIES; i++) {
+		if (!strcmp(name, REPLACEMENT_NAMES[i])) {
+			*p_policy = (replacement_t) i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+const char* replacement_name(replacement_t policy) {
+	return REPLACEMENT_NAMES[policy];
+}
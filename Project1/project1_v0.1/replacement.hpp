@@ -0,0 +1,252 @@
+#ifndef REPLACEMENT_HPP
+#define REPLACEMENT_HPP
+
+#include <cstdint>
+#include "way_search.hpp"
+
+/** Replacement policies selectable with -r */
+enum replacement_t {
+    REPL_LRU,           /* true LRU with a 64-bit stamp per way (default) */
+    REPL_TREE_PLRU,     /* binary tree of ways-1 bits per set */
+    REPL_BIT_PLRU,      /* one MRU bit per way, cleared when all are set */
+    REPL_SRRIP,         /* 2-bit re-reference prediction, inserted at long */
+    REPL_BRRIP,         /* SRRIP inserting at distant except 1 time in 32 */
+    REPL_FIFO,          /* round-robin pointer per set */
+    REPL_RANDOM,        /* pseudo-random way from a per-set draw counter */
+    REPL_LFU,           /* 32-bit use count per way, ties to the lowest way */
+    REPL_OPT,           /* Belady's OPT, needs the next use of every access (see opt.hpp) */
+    REPL_NUM_POLICIES
+};
+
+/**
+ * Replacement state of one cache. Only the arrays of the selected policy are
+ * allocated, all are set-major like the tags: way w of set n is entry
+ * n * ways + w of a per-way array, and the bit arrays use set_words 64-bit
+ * words per set.
+ */
+struct replacement_state_t {
+    int ways;
+    int way_bits;
+    int set_words;
+    void* storage;
+    uint64_t* stamps;       /* LRU, OPT: 2^63-1 minus the next use */
+    uint64_t clock;         /* LRU: next stamp */
+    uint64_t next_use;      /* OPT: next use of the block being accessed */
+    uint64_t* bits;         /* tree-PLRU, bit-PLRU */
+    uint8_t* rrpv;          /* SRRIP, BRRIP */
+    uint32_t* counts;       /* LFU: per way, FIFO: next victim per set */
+    uint32_t* draws;        /* random, BRRIP: random numbers drawn per set so far */
+    uint64_t set_stride;    /* random, BRRIP: set n is set n * set_stride + set_offset */
+    uint64_t set_offset;    /* of the whole cache, see replacement_set_numbering */
+    way_search_t search;    /* LRU victim search */
+};
+
+/** Allocates and clears the state policy needs for 2^set_bits sets of 2^way_bits ways */
+void replacement_init(replacement_state_t* r, replacement_t policy, int set_bits, int way_bits);
+void replacement_free(replacement_state_t* r);
+/**
+ * For a cache that holds a subset of the sets of a larger one (a shard):
+ * its set n is set n * stride + offset there, which is what the random
+ * draws are derived from, so they match those of the larger cache
+ */
+void replacement_set_numbering(replacement_state_t* r, uint64_t stride, uint64_t offset);
+
+/** Looks a policy up by its -r name, returns 0 on success and -1 if unknown */
+int parse_replacement(const char* name, replacement_t* p_policy);
+const char* replacement_name(replacement_t policy);
+
+/*
+ * The policies. Each one is a set of static functions the cache is
+ * instantiated with, so the hot path has no indirect calls:
+ *   touch   a hit on way of set
+ *   insert  a block was just placed in way of set
+ *   victim  the way to evict from a full set
+ */
+
+/**
+ * The next pseudo-random number of a set: a splitmix64 hash of the set's
+ * number in the whole cache and of how many numbers the set has drawn. Each
+ * set has its own sequence, so the draws do not depend on how the accesses
+ * of different sets interleave or on which sets a cache holds.
+ */
+static inline uint64_t replacement_next_random(replacement_state_t* r, uint64_t set) {
+    uint64_t z = (set * r->set_stride + r->set_offset) * 0x9e3779b97f4a7c15ULL +
+                 (uint64_t) r->draws[set]++ * 0xd1b54a32d192ed03ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+struct lru_policy {
+    static void touch(replacement_state_t* r, uint64_t set, int way) {
+        r->stamps[set * r->ways + way] = r->clock++;
+    }
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+        touch(r, set, way);
+    }
+    static int victim(replacement_state_t* r, uint64_t set) {
+        const uint64_t* set_stamps = r->stamps + set * r->ways;
+        return r->search.vectorized ? r->search.find_lru(set_stamps, r->ways) : find_lru_scalar(set_stamps, r->ways);
+    }
+};
+
+/** Node n of the tree (1 is the root, the children of n are 2n and 2n+1) points at the side to evict from */
+struct tree_plru_policy {
+    static void touch(replacement_state_t* r, uint64_t set, int way) {
+        uint64_t* set_bits = r->bits + set * r->set_words;
+        int node = 1;
+        int level;
+        for (level = r->way_bits - 1; level >= 0; level--) {
+            int right = (way >> level) & 1;
+            //point the node away from the way just used
+            if (right)
+                set_bits[node >> 6] &= ~((uint64_t) 1 << (node & 63));
+            else
+                set_bits[node >> 6] |= (uint64_t) 1 << (node & 63);
+            node = 2 * node + right;
+        }
+    }
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+        touch(r, set, way);
+    }
+    static int victim(replacement_state_t* r, uint64_t set) {
+        const uint64_t* set_bits = r->bits + set * r->set_words;
+        int node = 1;
+        while (node < r->ways)
+            node = 2 * node + (int) ((set_bits[node >> 6] >> (node & 63)) & 1);
+        return node - r->ways;
+    }
+};
+
+/** The bits of word w of a set that belong to a way */
+static inline uint64_t replacement_word_mask(int ways, int w) {
+    int left = ways - 64 * w;
+    return left >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << left) - 1;
+}
+
+struct bit_plru_policy {
+    static void touch(replacement_state_t* r, uint64_t set, int way) {
+        uint64_t* set_bits = r->bits + set * r->set_words;
+        set_bits[way >> 6] |= (uint64_t) 1 << (way & 63);
+        int w;
+        for (w = 0; w < r->set_words; w++) {
+            uint64_t mask = replacement_word_mask(r->ways, w);
+            if ((set_bits[w] & mask) != mask)
+                return;
+        }
+        //every way is marked recently used, keep only this one
+        for (w = 0; w < r->set_words; w++)
+            set_bits[w] = 0;
+        set_bits[way >> 6] = (uint64_t) 1 << (way & 63);
+    }
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+        touch(r, set, way);
+    }
+    static int victim(replacement_state_t* r, uint64_t set) {
+        const uint64_t* set_bits = r->bits + set * r->set_words;
+        int w;
+        for (w = 0; w < r->set_words; w++) {
+            uint64_t unused = ~set_bits[w] & replacement_word_mask(r->ways, w);
+            if (unused)
+                return 64 * w + __builtin_ctzll(unused);
+        }
+        return 0;
+    }
+};
+
+/** Largest re-reference prediction value of the 2-bit RRIP policies */
+static const uint8_t RRPV_DISTANT = 3;
+
+struct srrip_policy {
+    static void touch(replacement_state_t* r, uint64_t set, int way) {
+        r->rrpv[set * r->ways + way] = 0;
+    }
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+        r->rrpv[set * r->ways + way] = RRPV_DISTANT - 1;
+    }
+    static int victim(replacement_state_t* r, uint64_t set) {
+        uint8_t* set_rrpv = r->rrpv + set * r->ways;
+        //the first way with the largest prediction, aging the whole set so
+        //that it becomes distant
+        int evict_num = 0;
+        int i;
+        for (i = 1; i < r->ways; i++) {
+            if (set_rrpv[i] > set_rrpv[evict_num])
+                evict_num = i;
+        }
+        uint8_t age = RRPV_DISTANT - set_rrpv[evict_num];
+        if (age) {
+            for (i = 0; i < r->ways; i++)
+                set_rrpv[i] += age;
+        }
+        return evict_num;
+    }
+};
+
+struct brrip_policy : srrip_policy {
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+        bool is_long = (replacement_next_random(r, set) & 31) == 0;
+        r->rrpv[set * r->ways + way] = is_long ? RRPV_DISTANT - 1 : RRPV_DISTANT;
+    }
+};
+
+struct fifo_policy {
+    static void touch(replacement_state_t* r, uint64_t set, int way) {
+    }
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+        //blocks go in in way order, so the pointer follows the oldest block
+        if ((int) r->counts[set] == way)
+            r->counts[set] = (way + 1) & (r->ways - 1);
+    }
+    static int victim(replacement_state_t* r, uint64_t set) {
+        return r->counts[set];
+    }
+};
+
+struct random_policy {
+    static void touch(replacement_state_t* r, uint64_t set, int way) {
+    }
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+    }
+    static int victim(replacement_state_t* r, uint64_t set) {
+        return (int) (replacement_next_random(r, set) >> 32) & (r->ways - 1);
+    }
+};
+
+struct lfu_policy {
+    static void touch(replacement_state_t* r, uint64_t set, int way) {
+        uint32_t* count = r->counts + set * r->ways + way;
+        if (*count != UINT32_MAX)
+            (*count)++;
+    }
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+        r->counts[set * r->ways + way] = 1;
+    }
+    static int victim(replacement_state_t* r, uint64_t set) {
+        const uint32_t* set_counts = r->counts + set * r->ways;
+        int evict_num = 0;
+        int i;
+        for (i = 1; i < r->ways; i++) {
+            if (set_counts[i] < set_counts[evict_num])
+                evict_num = i;
+        }
+        return evict_num;
+    }
+};
+
+/**
+ * Evicts the block used again furthest in the future. Storing the complement
+ * of the next use turns that into the smallest stamp, the LRU victim search.
+ * The top bit is cleared since that search expects stamps below 2^63; a block
+ * never used again gets 0.
+ */
+struct opt_policy : lru_policy {
+    static void touch(replacement_state_t* r, uint64_t set, int way) {
+        r->stamps[set * r->ways + way] = ~r->next_use & (UINT64_MAX >> 1);
+    }
+    static void insert(replacement_state_t* r, uint64_t set, int way) {
+        touch(r, set, way);
+    }
+};
+
+#endif /* REPLACEMENT_HPP */
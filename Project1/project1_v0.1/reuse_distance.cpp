@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstring>
+#include "reuse_distance.hpp"
+
+//number of times the tree starts with
+static const uint64_t REUSE_INITIAL_TIMES = 1 << 16;
+//the tree is resized to this many times the distinct blocks, so the live
+//marks are renumbered once every (REUSE_TIMES_PER_BLOCK - 1) * D accesses
+static const uint64_t REUSE_TIMES_PER_BLOCK = 4;
+//slots the hash table starts with, it is kept at most half full
+static const uint64_t REUSE_INITIAL_SLOTS = 1 << 16;
+//time of an empty hash table slot
+static const uint64_t REUSE_NO_TIME = UINT64_MAX;
+
+/**
+ * Sets up an empty histogram
+ *
+ * @b1 The size of the blocks in bytes: 2^b-byte blocks.
+ */
+ReuseDistance::ReuseDistance(uint64_t b1) {
+    block_bits = b1;
+    slot_t empty = { 0, REUSE_NO_TIME };
+    table.assign(REUSE_INITIAL_SLOTS, empty);
+    num_blocks = 0;
+    tree.assign(REUSE_INITIAL_TIMES + 1, 0);
+    owner.resize(REUSE_INITIAL_TIMES);
+    now = 0;
+    memset(&hist, 0, sizeof(hist));
+}
+
+/** The slot holding block, or the empty slot where it would go */
+inline ReuseDistance::slot_t* ReuseDistance::find_slot(uint64_t block) {
+    uint64_t mask = table.size() - 1;
+    uint64_t i = (block * 0x9e3779b97f4a7c15ULL) >> 32 & mask;
+    while (table[i].time != REUSE_NO_TIME && table[i].block != block)
+        i = (i + 1) & mask;
+    return &table[i];
+}
+
+void ReuseDistance::grow_table() {
+    std::vector<slot_t> old;
+    old.swap(table);
+    slot_t empty = { 0, REUSE_NO_TIME };
+    table.assign(2 * old.size(), empty);
+    size_t i;
+    for (i = 0; i < old.size(); i++) {
+        if (old[i].time != REUSE_NO_TIME) {
+            slot_t* slot = find_slot(old[i].block);
+            *slot = old[i];
+            owner[slot->time] = slot - &table[0];
+        }
+    }
+}
+
+inline void ReuseDistance::add(uint64_t time, int32_t delta) {
+    uint64_t i;
+    for (i = time + 1; i < tree.size(); i += i & (~i + 1))
+        tree[i] += delta;
+}
+
+/** Number of marks at times 0 .. time */
+inline uint64_t ReuseDistance::prefix(uint64_t time) {
+    uint64_t sum = 0;
+    uint64_t i;
+    for (i = time + 1; i > 0; i -= i & (~i + 1))
+        sum += tree[i];
+    return sum;
+}
+
+/**
+ * Renumbers the last access times of all blocks 0 .. D-1 in the same order
+ * and rebuilds the tree, which is resized so that most of it is free. The
+ * owner of each time is still its block's last access exactly when the
+ * block's time matches, so one pass over the times finds the live ones in
+ * order.
+ */
+void ReuseDistance::compact() {
+    uint64_t d = 0;
+    uint64_t t;
+    for (t = 0; t < now; t++) {
+        slot_t* slot = &table[owner[t]];
+        if (slot->time == t) {
+            slot->time = d;
+            owner[d++] = owner[t];
+        }
+    }
+    now = d;
+
+    uint64_t times = std::max((uint64_t) tree.size() - 1, REUSE_TIMES_PER_BLOCK * d);
+    owner.resize(times);
+    tree.assign(times + 1, 0);
+    uint64_t i;
+    //a tree with marks at 0 .. d-1: node i covers times (i - lowbit(i), i]
+    for (i = 1; i <= times; i++) {
+        uint64_t low = i - (i & (~i + 1));
+        tree[i] = i <= d ? i - low : (low < d ? d - low : 0);
+    }
+}
+
+/**
+ * Records the reuse distance of one trace event
+ *
+ * @arg  The target memory address
+ */
+void ReuseDistance::access(uint64_t arg) {
+    if (now == tree.size() - 1)
+        compact();
+
+    hist.accesses++;
+    uint64_t block = arg >> block_bits;
+    slot_t* slot = find_slot(block);
+    if (slot->time == REUSE_NO_TIME) {
+        hist.cold++;
+        slot->block = block;
+        slot->time = now;
+        owner[now] = slot - &table[0];
+        add(now, 1);
+        now++;
+        if (++num_blocks * 2 > table.size())
+            grow_table();
+        return;
+    }
+
+    //every mark after the previous access is a distinct block touched since
+    uint64_t last = slot->time;
+    uint64_t distance = num_blocks - prefix(last);
+    if (distance < (uint64_t) REUSE_EXACT)
+        hist.exact[distance]++;
+    else
+        hist.log2[63 - __builtin_clzll(distance)]++;
+    add(last, -1);
+    add(now, 1);
+    slot->time = now;
+    owner[now] = slot - &table[0];
+    now++;
+}
+
+/**
+ * Copies out the histogram
+ *
+ * @p_hist Pointer to the histogram
+ */
+void ReuseDistance::complete(reuse_histogram_t* p_hist) {
+    *p_hist = hist;
+}
@@ -0,0 +1,57 @@
+#ifndef REUSE_DISTANCE_HPP
+#define REUSE_DISTANCE_HPP
+
+#include <vector>
+#include "cachesim.hpp"
+
+/** Distances below this are counted exactly, longer ones in log2 buckets */
+static const int REUSE_EXACT = 64;
+
+/** Reuse distances of a trace: distinct blocks touched between two accesses to a block */
+struct reuse_histogram_t {
+    uint64_t exact[REUSE_EXACT];    /* exact[d]: distance d */
+    uint64_t log2[64];              /* log2[k]: distances in [2^k, 2^(k+1)), for 2^k >= REUSE_EXACT */
+    uint64_t cold;                  /* first accesses to a block */
+    uint64_t accesses;
+};
+
+/*
+ * Fully associative reuse (LRU stack) distances at block granularity in
+ * O(log D) per access, D being the number of distinct blocks. Every block
+ * keeps a mark at the time of its last access in a Fenwick tree, so the
+ * distance of an access is the number of marks after the block's previous
+ * one. When the times run past the end of the tree the live marks are
+ * renumbered 0 .. D-1, keeping the tree O(D) however long the trace is.
+ * The last access times are kept in an open-addressing hash table, which
+ * is several times faster than a node-based map at millions of blocks.
+ */
+class ReuseDistance {
+public:
+    explicit ReuseDistance(uint64_t b1);
+
+    void access(uint64_t arg);
+    void complete(reuse_histogram_t* p_hist);
+
+private:
+    /** A slot of the hash table, empty when time is REUSE_NO_TIME */
+    struct slot_t {
+        uint64_t block;
+        uint64_t time;
+    };
+
+    slot_t* find_slot(uint64_t block);
+    void grow_table();
+    void add(uint64_t time, int32_t delta);
+    uint64_t prefix(uint64_t time);
+    void compact();
+
+    int block_bits;
+    std::vector<slot_t> table;      /* block -> last access time, linear probing */
+    uint64_t num_blocks;            /* occupied slots */
+    std::vector<uint32_t> tree;     /* Fenwick tree over times, 1-based */
+    std::vector<uint32_t> owner;    /* time -> slot accessed then, for renumbering */
+    uint64_t now;                   /* time of the next access */
+    reuse_histogram_t hist;
+};
+
+#endif /* REUSE_DISTANCE_HPP */
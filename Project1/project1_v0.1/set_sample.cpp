@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "set_sample.hpp"
+
+//miss penalty of the single-level model, as in calculate_ratios
+static const double MEMORY_PENALTY = 20;
+
+/**
+ * Sets up the cache and picks the sampled sets
+ *
+ * @c1 The total number of bytes for data storage is 2^c
+ * @b1 The size of the blocks in bytes: 2^b-byte blocks.
+ * @s1 The number of blocks in each set: 2^s blocks per set.
+ * @policy The replacement policy
+ * @ratio One set in ratio is simulated
+ */
+SetSampler::SetSampler(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy, uint64_t ratio) {
+    cache = new Cache(c1, b1, s1, policy);
+    S = s1;
+    uint64_t set_bits = c1 - b1 - s1;
+    uint64_t num_sets = (uint64_t) 1 << set_bits;
+    index_shift = b1;
+    index_mask = num_sets - 1;
+    sampled_sets = num_sets / ratio > 0 ? num_sets / ratio : 1;
+    sampled.assign(num_sets, 0);
+    set_accesses.assign(num_sets, 0);
+    set_misses.assign(num_sets, 0);
+    set_reads.assign(num_sets, 0);
+    set_read_misses.assign(num_sets, 0);
+
+    //rank the sets by a 64-bit mix of their number and keep the lowest
+    //sampled_sets, an exact count spread over the whole index range
+    std::vector<std::pair<uint64_t, uint64_t> > ranks(num_sets);
+    uint64_t set_num;
+    for (set_num = 0; set_num < num_sets; set_num++) {
+        uint64_t h = set_num + 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        ranks[set_num] = std::make_pair(h ^ (h >> 31), set_num);
+    }
+    std::nth_element(ranks.begin(), ranks.begin() + (sampled_sets - 1), ranks.end());
+    uint64_t i;
+    for (i = 0; i < sampled_sets; i++)
+        sampled[ranks[i].second] = 1;
+    accesses = 0;
+    reads = 0;
+}
+
+SetSampler::~SetSampler() {
+    delete cache;
+}
+
+/**
+ * Simulates an access to a sampled set
+ *
+ * @type The type of event, can be READ or WRITE.
+ * @arg  The target memory address
+ * @set_num The set it maps to
+ */
+void SetSampler::simulate(char type, uint64_t arg, uint64_t set_num) {
+    cache_victim_t victim;
+    bool read = type == 'r';
+    set_accesses[set_num]++;
+    set_reads[set_num] += read;
+    if (!cache->access(type, arg, &victim)) {
+        set_misses[set_num]++;
+        set_read_misses[set_num] += read;
+    }
+}
+
+/** Scales a sampled count by the whole-trace to sampled ratio of its base */
+static uint64_t scale(uint64_t count, uint64_t sampled_base, uint64_t base) {
+    return sampled_base ? (uint64_t) llround(count * (double) base / sampled_base) : 0;
+}
+
+/**
+ * Scales the sampled statistics up to the whole cache
+ *
+ * @p_stats Pointer to the statistics structure
+ */
+void SetSampler::complete(set_sample_stats_t* p_stats) {
+    cache_stats_t part;
+    cache->complete(&part);
+
+    //reads and writes are counted over the whole trace, the misses and
+    //write-backs are scaled by the sampled fraction of each
+    cache_stats_t* p = &p_stats->estimate;
+    memset(p, 0, sizeof(*p));
+    p->accesses = accesses;
+    p->reads = reads;
+    p->writes = accesses - reads;
+    p->read_misses_l1 = scale(part.read_misses_l1, part.reads, p->reads);
+    p->write_misses_l1 = scale(part.write_misses_l1, part.writes, p->writes);
+    p->read_hits_l1 = p->reads - p->read_misses_l1;
+    p->write_hits_l1 = p->writes - p->write_misses_l1;
+    p->total_misses_l1 = p->read_misses_l1 + p->write_misses_l1;
+    p->total_hits_l1 = p->accesses - p->total_misses_l1;
+    p->write_back_l1 = scale(part.write_back_l1, part.accesses, p->accesses);
+    calculate_ratios(p, S);
+
+    p_stats->sets = index_mask + 1;
+    p_stats->sampled_sets = sampled_sets;
+    p_stats->sampled_accesses = part.accesses;
+
+    //the estimate is W_r * R_r + W_w * R_w, R_t = sum(m_t) / sum(a_t) over n of
+    //N sets and W_t the trace fraction of type t. Linearized, its variance is
+    //(1 - n/N) * sum(z_i^2) / (n - 1) / n, with the per-set residual
+    //z_i = sum over t of W_t * (m_t,i - R_t * a_t,i) / mean(a_t)
+    double n = (double) sampled_sets;
+    double N = (double) p_stats->sets;
+    p_stats->miss_ratio_ci = -1;
+    p_stats->avg_access_time_ci = -1;
+    if (sampled_sets > 1 && part.accesses > 0) {
+        double R_r = part.reads ? part.read_misses_l1 / (double) part.reads : 0;
+        double R_w = part.writes ? part.write_misses_l1 / (double) part.writes : 0;
+        //a type never sampled adds nothing to the estimate nor to its spread
+        double k_r = part.reads ? (p->reads / (double) accesses) / (part.reads / n) : 0;
+        double k_w = part.writes ? (p->writes / (double) accesses) / (part.writes / n) : 0;
+        double spread = 0;
+        uint64_t set_num;
+        for (set_num = 0; set_num <= index_mask; set_num++) {
+            if (!sampled[set_num])
+                continue;
+            double set_writes = (double) (set_accesses[set_num] - set_reads[set_num]);
+            double set_write_misses = (double) (set_misses[set_num] - set_read_misses[set_num]);
+            double z = k_r * (set_read_misses[set_num] - R_r * set_reads[set_num]) +
+                       k_w * (set_write_misses - R_w * set_writes);
+            spread += z * z;
+        }
+        double variance = (1 - n / N) * spread / (n - 1) / n;
+        p_stats->miss_ratio_ci = SAMPLE_Z95 * sqrt(variance);
+        //AAT is linear in the miss ratio
+        p_stats->avg_access_time_ci = MEMORY_PENALTY * p_stats->miss_ratio_ci;
+    }
+}
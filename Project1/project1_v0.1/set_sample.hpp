@@ -0,0 +1,65 @@
+#ifndef SET_SAMPLE_HPP
+#define SET_SAMPLE_HPP
+
+#include <vector>
+#include "cachesim.hpp"
+
+/** Normal quantile of the two-sided 95% confidence intervals */
+static const double SAMPLE_Z95 = 1.96;
+
+struct set_sample_stats_t {
+    cache_stats_t estimate;         /* full-cache statistics scaled up from the sampled sets */
+    uint64_t sets;                  /* sets in the cache */
+    uint64_t sampled_sets;
+    uint64_t sampled_accesses;      /* accesses that were simulated */
+    double miss_ratio_ci;           /* half-width of the 95% interval on the miss ratio, <0 if unknown */
+    double avg_access_time_ci;      /* same for the average access time */
+};
+
+/*
+ * Estimates a cache from a hashed subset of its sets. Sets only interact
+ * through the trace, so simulating 1/ratio of them exactly and skipping every
+ * other access right after the set index is decoded gives an unbiased view
+ * of those sets. The estimate is stratified by access type: the read and
+ * write miss ratios are ratio estimators over the sampled sets, weighted by
+ * the exact read and write fractions of the whole trace. Its confidence
+ * interval comes from the per-set residuals of both ratios, combined with
+ * the same weights (cluster sampling, finite population corrected).
+ */
+class SetSampler {
+public:
+    /** One set in every ratio is simulated, at least one */
+    SetSampler(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy, uint64_t ratio);
+    ~SetSampler();
+
+    void access(char type, uint64_t arg) {
+        //branch-free, the type is as good as random in most traces
+        accesses++;
+        reads += type == 'r';
+        uint64_t set_num = (arg >> index_shift) & index_mask;
+        if (sampled[set_num])
+            simulate(type, arg, set_num);
+    }
+    void complete(set_sample_stats_t* p_stats);
+
+private:
+    SetSampler(const SetSampler&);
+    SetSampler& operator=(const SetSampler&);
+
+    void simulate(char type, uint64_t arg, uint64_t set_num);
+
+    Cache* cache;                   /* full geometry, only the sampled sets are touched */
+    uint64_t S;
+    int index_shift;
+    uint64_t index_mask;
+    uint64_t sampled_sets;
+    std::vector<uint8_t> sampled;   /* per set, 1 if it is simulated */
+    std::vector<uint64_t> set_accesses;
+    std::vector<uint64_t> set_misses;
+    std::vector<uint64_t> set_reads;
+    std::vector<uint64_t> set_read_misses;
+    uint64_t accesses;              /* whole trace */
+    uint64_t reads;
+};
+
+#endif /* SET_SAMPLE_HPP */
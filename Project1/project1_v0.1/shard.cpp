@@ -0,0 +1,86 @@
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "shard.hpp"
+
+/** The geometry of one shard's cache, see simulate_shard */
+struct shard_geometry_t {
+    int block_bits;                 /* B1 */
+    int set_bits;                   /* log2 of the sets of the whole cache */
+    int local_set_bits;             /* log2 of the sets of the shard's cache */
+    uint64_t s1;
+};
+
+/**
+ * Simulates one shard straight from the shared trace: every record is
+ * checked and only those of the shard's sets (set modulo shards) are
+ * replayed, in trace order. The shard's cache only holds those sets, set
+ * s of the whole cache being set s / shards of the shard's, and the address
+ * is rewritten to match; the tag is unchanged, so hits, misses and
+ * write-backs are the same as in the full cache.
+ */
+static void simulate_shard(const mapped_trace_t* p_trace, unsigned shard, unsigned shards, shard_geometry_t geometry,
+                           replacement_t policy, cache_stats_t* p_stats) {
+    int b1 = geometry.block_bits;
+    Cache cache(b1 + geometry.local_set_bits + geometry.s1, b1, geometry.s1, policy);
+    cache.set_shard(shards, shard);
+    uint64_t index_mask = ((uint64_t) 1 << geometry.set_bits) - 1;
+    int tag_shift = b1 + geometry.set_bits;
+    uint64_t offset_mask = ((uint64_t) 1 << b1) - 1;
+    uint64_t i;
+    for (i = 0; i < p_trace->count; i++) {
+        uint64_t address = trace_record_address(p_trace, i);
+        uint64_t set_num = (address >> b1) & index_mask;
+        if (set_num % shards != shard)
+            continue;
+        uint64_t local = ((address >> tag_shift) << (b1 + geometry.local_set_bits)) | ((set_num / shards) << b1) |
+                         (address & offset_mask);
+        cache.access(trace_record_type(p_trace, i), local);
+    }
+    cache.complete(p_stats);
+}
+
+/**
+ * Subroutine for running one configuration sharded by set
+ *
+ * @p_trace The trace
+ * @c1 The total number of bytes for data storage in L1 is 2^c
+ * @b1 The size of L1's blocks in bytes: 2^b-byte blocks.
+ * @s1 The number of blocks in each set of L1: 2^s blocks per set.
+ * @policy The replacement policy
+ * @threads The number of threads, at most one per set is used
+ * @p_stats Pointer to the statistics structure, filled in with the totals
+ */
+void run_sharded(const mapped_trace_t* p_trace, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy,
+                 unsigned threads, cache_stats_t* p_stats) {
+    uint64_t set_bits = c1 - b1 - s1;
+    uint64_t num_sets = (uint64_t) 1 << set_bits;
+    if (threads > num_sets)
+        threads = num_sets;
+    if (threads < 1)
+        threads = 1;
+
+    //every thread replays the sets of one shard from the shared trace
+    shard_geometry_t geometry;
+    geometry.block_bits = (int) b1;
+    geometry.set_bits = (int) set_bits;
+    geometry.local_set_bits = 0;
+    while (((uint64_t) 1 << geometry.local_set_bits) * threads < num_sets)
+        geometry.local_set_bits++;
+    geometry.s1 = s1;
+    std::vector<cache_stats_t> parts(threads);
+    std::vector<std::thread> pool;
+    unsigned t;
+    for (t = 0; t < threads; t++) {
+        pool.push_back(std::thread(simulate_shard, p_trace, t, threads, geometry, policy, &parts[t]));
+    }
+    for (t = 0; t < threads; t++) {
+        pool[t].join();
+    }
+
+    memset(p_stats, 0, sizeof(*p_stats));
+    for (t = 0; t < threads; t++) {
+        accumulate_stats(p_stats, &parts[t]);
+    }
+    calculate_ratios(p_stats, s1);
+}
@@ -0,0 +1,19 @@
+#ifndef SHARD_HPP
+#define SHARD_HPP
+
+#include "cachesim.hpp"
+#include "trace.hpp"
+
+/**
+ * Simulates one configuration on several threads. Sets are independent
+ * under per-set replacement, so the trace is partitioned by set index (set
+ * modulo threads) and each partition is replayed in trace order on its own
+ * thread. Every thread reads the shared trace in place and its cache only
+ * has the sets it owns, so memory stays at the trace plus about one cache
+ * however many threads run. The per-thread counters are summed, so the
+ * statistics are identical to a serial run, write-backs included.
+ */
+void run_sharded(const mapped_trace_t* p_trace, uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy,
+                 unsigned threads, cache_stats_t* p_stats);
+
+#endif /* SHARD_HPP */
@@ -0,0 +1,55 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+/*
+ * A bounded single-producer/single-consumer ring of SLOTS preallocated
+ * elements (a power of two). The producer fills the slot returned by
+ * write_slot in place and publishes it with push; the consumer reads the
+ * slot returned by read_slot and hands it back with pop. Each index is only
+ * written by one side, a release store paired with the other side's acquire
+ * load, so no locks are needed. The two indices live on separate cache lines
+ * so that the sides do not false-share. Waiting yields the CPU.
+ */
+template <class T, size_t SLOTS>
+class SpscRing {
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    /** Producer: the next free slot, waiting while the ring is full */
+    T* write_slot() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        while (t - head.load(std::memory_order_acquire) == SLOTS)
+            std::this_thread::yield();
+        return &slots[t & (SLOTS - 1)];
+    }
+    /** Producer: makes the slot from write_slot visible to the consumer */
+    void push() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** Consumer: the oldest published slot, waiting while the ring is empty */
+    T* read_slot() {
+        size_t h = head.load(std::memory_order_relaxed);
+        while (tail.load(std::memory_order_acquire) == h)
+            std::this_thread::yield();
+        return &slots[h & (SLOTS - 1)];
+    }
+    /** Consumer: returns the slot from read_slot to the producer */
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    SpscRing(const SpscRing&);
+    SpscRing& operator=(const SpscRing&);
+
+    alignas(64) std::atomic<size_t> head;   /* next slot to read, written by the consumer */
+    alignas(64) std::atomic<size_t> tail;   /* next slot to write, written by the producer */
+    alignas(64) T slots[SLOTS];
+};
+
+#endif /* SPSC_RING_HPP */
@@ -0,0 +1,132 @@
+#include "stack_distance.hpp"
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+//marks a stack entry that is clean in caches of every associativity
+static const int32_t STACK_CLEAN = INT32_MAX;
+
+/**
+ * Sets up empty stacks for the stack distance simulation
+ *
+ * @b1 The size of the blocks in bytes: 2^b-byte blocks.
+ * @set_bits The number of sets is 2^set_bits.
+ * @s_max The largest associativity simulated is 2^s_max.
+ */
+StackDistance::StackDistance(uint64_t b1, uint64_t set_bits, uint64_t s_max) {
+	this->s_max = s_max;
+	max_ways = (uint64_t) 1 << s_max;
+	num_sets = (uint64_t) 1 << set_bits;
+	index_shift = b1;
+	index_mask = num_sets - 1;
+	tag_shift = b1 + set_bits;
+
+	uint64_t entries = num_sets * max_ways;
+	tags = new uint64_t[entries];
+	dirty = new int32_t[entries];
+	used = new uint64_t[num_sets]();
+	read_distance = new uint64_t[max_ways + 1]();
+	write_distance = new uint64_t[max_ways + 1]();
+	write_backs = new uint64_t[s_max + 1]();
+}
+
+StackDistance::~StackDistance() {
+	delete[] tags;
+	delete[] dirty;
+	delete[] used;
+	delete[] read_distance;
+	delete[] write_distance;
+	delete[] write_backs;
+}
+
+/**
+ * Subroutine that records the stack distance of one trace event and moves
+ * the block to the top of its set's stack
+ *
+ * @type The type of event, can be READ or WRITE.
+ * @arg  The target memory address
+ */
+void StackDistance::access(char type, uint64_t arg) {
+	uint64_t set_num = (arg >> index_shift) & index_mask;
+	uint64_t tag_value = arg >> tag_shift;
+	uint64_t* set_tags = tags + set_num * max_ways;
+	int32_t* set_dirty = dirty + set_num * max_ways;
+	uint64_t set_used = used[set_num];
+
+	//find the stack distance, set_used if the block is not in the stack
+	uint64_t distance;
+	for (distance = 0; distance < set_used; distance++) {
+		if (set_tags[distance] == tag_value)
+			break;
+	}
+	bool found = distance < set_used;
+
+	if (type == 'r')
+		read_distance[found ? distance : max_ways]++;
+	else
+		write_distance[found ? distance : max_ways]++;
+
+	//the entries above the block move down one place. The entry moving from
+	//depth A-1 to A leaves the A-way cache, a write-back if it is dirty there.
+	uint64_t ways;
+	for (ways = 1; ways <= distance && ways <= max_ways; ways <<= 1) {
+		if (set_dirty[ways - 1] < (int32_t) ways)
+			write_backs[__builtin_ctzll(ways)]++;
+	}
+
+	int32_t top_dirty;
+	if (type == 'w')
+		top_dirty = -1;
+	else if (found && set_dirty[distance] != STACK_CLEAN)
+		top_dirty = set_dirty[distance] > (int32_t) distance ? set_dirty[distance] : (int32_t) distance;
+	else
+		top_dirty = STACK_CLEAN;
+
+	//shift, dropping the bottom entry if the stack is full
+	uint64_t moved = distance < max_ways ? distance : max_ways - 1;
+	memmove(set_tags + 1, set_tags, moved * sizeof(uint64_t));
+	memmove(set_dirty + 1, set_dirty, moved * sizeof(int32_t));
+	set_tags[0] = tag_value;
+	set_dirty[0] = top_dirty;
+	if (!found && set_used < max_ways)
+		used[set_num]++;
+}
+
+/**
+ * Subroutine for turning the stack distance histograms into per-associativity
+ * statistics
+ *
+ * @p_stats Array of s_max + 1 statistics structures
+ */
+void StackDistance::complete(cache_stats_t* p_stats) {
+	uint64_t reads = 0, writes = 0;
+	uint64_t d;
+	for (d = 0; d <= max_ways; d++) {
+		reads += read_distance[d];
+		writes += write_distance[d];
+	}
+
+	//hits in a 2^s-way cache are the accesses with a distance below 2^s
+	uint64_t read_hits = 0, write_hits = 0;
+	uint64_t s;
+	d = 0;
+	for (s = 0; s <= s_max; s++) {
+		for (; d < ((uint64_t) 1 << s); d++) {
+			read_hits += read_distance[d];
+			write_hits += write_distance[d];
+		}
+		cache_stats_t* p = &p_stats[s];
+		memset(p, 0, sizeof(*p));
+		p->accesses = reads + writes;
+		p->reads = reads;
+		p->writes = writes;
+		p->read_hits_l1 = read_hits;
+		p->read_misses_l1 = reads - read_hits;
+		p->write_hits_l1 = write_hits;
+		p->write_misses_l1 = writes - write_hits;
+		p->total_hits_l1 = read_hits + write_hits;
+		p->total_misses_l1 = p->accesses - p->total_hits_l1;
+		p->write_back_l1 = write_backs[s];
+		calculate_ratios(p, s);
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef STACK_DISTANCE_HPP
+#define STACK_DISTANCE_HPP
+
+#include "cachesim.hpp"
+
+/*
+ * Single-pass simulation of every associativity 2^0 .. 2^s_max at a fixed
+ * block size and number of sets. LRU has the inclusion property: a block hits
+ * in an A-way set exactly when its per-set LRU stack distance is below A. So
+ * one pass that records stack distances gives the hit and miss counts of all
+ * associativities at once. Write-backs are counted too, by tracking for every
+ * stack entry the associativities in which it is currently dirty.
+ */
+class StackDistance {
+public:
+    StackDistance(uint64_t b1, uint64_t set_bits, uint64_t s_max);
+    ~StackDistance();
+
+    void access(char type, uint64_t arg);
+    /**
+     * Fills p_stats[s] with the statistics of the 2^s-way cache for s in
+     * 0 .. s_max, as complete_cache would for c = b + set_bits + s
+     */
+    void complete(cache_stats_t* p_stats);
+
+private:
+    StackDistance(const StackDistance&);
+    StackDistance& operator=(const StackDistance&);
+
+    //geometry: the LRU stack of each set is tracked to a depth of max_ways
+    uint64_t s_max, max_ways, num_sets;
+    int index_shift, tag_shift;
+    uint64_t index_mask;
+
+    //per-set LRU stacks, set-major with the most recently used block first
+    uint64_t* tags;
+    //per stack entry, the largest stack distance the block was read at since it
+    //was last written. The block is dirty in an A-way cache exactly when this is
+    //below A: any read at a distance >= A was a miss that refilled it clean.
+    int32_t* dirty;
+    //number of valid entries in each set's stack
+    uint64_t* used;
+
+    //histograms of stack distances, index max_ways counts cold and deeper accesses
+    uint64_t* read_distance;
+    uint64_t* write_distance;
+    //write-backs from the 2^s-way cache, indexed by s
+    uint64_t* write_backs;
+};
+
+#endif /* STACK_DISTANCE_HPP */
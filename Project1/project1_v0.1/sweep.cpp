@@ -0,0 +1,98 @@
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <thread>
+#include <vector>
+#include "sweep.hpp"
+
+/**
+ * Worker loop: claims configurations until none are left and simulates each
+ * in a cache of its own
+ */
+static void sweep_worker(const mapped_trace_t* p_trace, sweep_point_t* points, size_t num_points,
+                         std::atomic<size_t>* next) {
+    size_t i;
+    while ((i = next->fetch_add(1)) < num_points) {
+        sweep_point_t* p = &points[i];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        Cache cache(p->c, p->b, p->s, p->policy);
+        uint64_t r;
+        for (r = 0; r < p_trace->count; r++) {
+            cache.access(trace_record_type(p_trace, r), trace_record_address(p_trace, r));
+        }
+        cache.complete(&p->stats);
+
+        p->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+/**
+ * Subroutine for running a design-space sweep
+ *
+ * @p_trace The trace, shared read-only by all threads
+ * @points The configurations, results are written into them
+ * @num_points Number of configurations
+ * @threads Size of the thread pool
+ */
+void run_sweep(const mapped_trace_t* p_trace, sweep_point_t* points, size_t num_points, unsigned threads) {
+    std::atomic<size_t> next(0);
+    if (threads > num_points)
+        threads = num_points;
+    if (threads <= 1) {
+        sweep_worker(p_trace, points, num_points, &next);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    unsigned t;
+    for (t = 0; t < threads; t++) {
+        pool.push_back(std::thread(sweep_worker, p_trace, points, num_points, &next));
+    }
+    for (t = 0; t < threads; t++) {
+        pool[t].join();
+    }
+}
+
+void print_sweep_header(FILE* out, sweep_format_t format) {
+    if (format == SWEEP_CSV) {
+        fprintf(out, "c,b,s,accesses,reads,read_hits_l1,read_misses_l1,writes,write_hits_l1,write_misses_l1,"
+                     "write_back_l1,total_hits_l1,total_misses_l1,total_hit_ratio,total_miss_ratio,"
+                     "read_hit_ratio,read_miss_ratio,write_hit_ratio,write_miss_ratio,avg_access_time_l1,seconds\n");
+    }
+}
+
+/**
+ * Prints the full statistics of one configuration as a CSV row or JSON object
+ *
+ * @out The output stream
+ * @format SWEEP_CSV or SWEEP_JSON
+ * @p_point The configuration and its results
+ */
+void print_sweep_row(FILE* out, sweep_format_t format, const sweep_point_t* p_point) {
+    const cache_stats_t* p = &p_point->stats;
+    if (format == SWEEP_CSV) {
+        fprintf(out, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                     ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                     ",%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f\n",
+                p_point->c, p_point->b, p_point->s, p->accesses, p->reads, p->read_hits_l1, p->read_misses_l1,
+                p->writes, p->write_hits_l1, p->write_misses_l1, p->write_back_l1, p->total_hits_l1,
+                p->total_misses_l1, p->total_hit_ratio, p->total_miss_ratio, p->read_hit_ratio,
+                p->read_miss_ratio, p->write_hit_ratio, p->write_miss_ratio, p->avg_access_time_l1,
+                p_point->seconds);
+    } else {
+        fprintf(out, "{\"c\": %" PRIu64 ", \"b\": %" PRIu64 ", \"s\": %" PRIu64 ", \"accesses\": %" PRIu64
+                     ", \"reads\": %" PRIu64 ", \"read_hits_l1\": %" PRIu64 ", \"read_misses_l1\": %" PRIu64
+                     ", \"writes\": %" PRIu64 ", \"write_hits_l1\": %" PRIu64 ", \"write_misses_l1\": %" PRIu64
+                     ", \"write_back_l1\": %" PRIu64 ", \"total_hits_l1\": %" PRIu64
+                     ", \"total_misses_l1\": %" PRIu64 ", \"total_hit_ratio\": %.6f"
+                     ", \"total_miss_ratio\": %.6f, \"read_hit_ratio\": %.6f, \"read_miss_ratio\": %.6f"
+                     ", \"write_hit_ratio\": %.6f, \"write_miss_ratio\": %.6f, \"avg_access_time_l1\": %.6f"
+                     ", \"seconds\": %.3f}\n",
+                p_point->c, p_point->b, p_point->s, p->accesses, p->reads, p->read_hits_l1, p->read_misses_l1,
+                p->writes, p->write_hits_l1, p->write_misses_l1, p->write_back_l1, p->total_hits_l1,
+                p->total_misses_l1, p->total_hit_ratio, p->total_miss_ratio, p->read_hit_ratio,
+                p->read_miss_ratio, p->write_hit_ratio, p->write_miss_ratio, p->avg_access_time_l1,
+                p_point->seconds);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <cstdio>
+#include "cachesim.hpp"
+#include "trace.hpp"
+
+/** One (C, B, S) configuration of a design-space sweep and its results */
+struct sweep_point_t {
+    uint64_t c;
+    uint64_t b;
+    uint64_t s;
+    replacement_t policy;
+    cache_stats_t stats;
+    double seconds;             /* wall time of this configuration */
+};
+
+/** Output format of sweep results, one row per configuration */
+enum sweep_format_t {
+    SWEEP_CSV,
+    SWEEP_JSON                  /* JSON lines, one object per configuration */
+};
+
+/**
+ * Simulates every configuration over the same in-memory trace on a pool of
+ * threads, each configuration on one thread with its own cache
+ */
+void run_sweep(const mapped_trace_t* p_trace, sweep_point_t* points, size_t num_points, unsigned threads);
+
+void print_sweep_header(FILE* out, sweep_format_t format);
+void print_sweep_row(FILE* out, sweep_format_t format, const sweep_point_t* p_point);
+
+#endif /* SWEEP_HPP */
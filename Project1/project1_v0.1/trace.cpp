@@ -0,0 +1,358 @@
+#ifdef CCOMPILER
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#else
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace.hpp"
+
+/**
+ * Subroutine for checking whether a trace file uses the binary format
+ *
+ * @path The trace file
+ */
+int trace_is_binary(const char* path) {
+    char magic[sizeof(TRACE_BINARY_MAGIC)];
+    FILE* in = fopen(path, "rb");
+    if (in == NULL)
+        return 0;
+    size_t n = fread(magic, 1, sizeof(magic), in);
+    fclose(in);
+    return n == sizeof(magic) && memcmp(magic, TRACE_BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * Subroutine for checking whether a trace file uses the compressed format
+ *
+ * @path The trace file
+ */
+int trace_is_compressed(const char* path) {
+    char magic[sizeof(TRACE_COMPRESSED_MAGIC)];
+    FILE* in = fopen(path, "rb");
+    if (in == NULL)
+        return 0;
+    size_t n = fread(magic, 1, sizeof(magic), in);
+    fclose(in);
+    return n == sizeof(magic) && memcmp(magic, TRACE_COMPRESSED_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * Maps a whole trace file read-only, checking its magic string
+ *
+ * @path The trace file
+ * @magic The magic string of the expected format
+ * @p_trace Filled in with base and length on success
+ */
+static int trace_map_file(const char* path, const char* magic, mapped_trace_t* p_trace) {
+    memset(p_trace, 0, sizeof(*p_trace));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < TRACE_HEADER_BYTES) {
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    //the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (base == MAP_FAILED)
+        return -1;
+
+    if (memcmp(base, magic, TRACE_HEADER_BYTES) != 0) {
+        munmap(base, st.st_size);
+        return -1;
+    }
+    madvise(base, st.st_size, MADV_SEQUENTIAL);
+
+    p_trace->base = (const unsigned char*) base;
+    p_trace->records = p_trace->base + TRACE_HEADER_BYTES;
+    p_trace->length = st.st_size;
+    return 0;
+}
+
+/**
+ * Subroutine for mapping a binary trace file into memory. The mapping is
+ * advised as sequential so the kernel reads ahead of the simulator.
+ *
+ * @path The trace file
+ * @p_trace Filled in with the mapping on success
+ */
+int trace_map(const char* path, mapped_trace_t* p_trace) {
+    if (trace_map_file(path, TRACE_BINARY_MAGIC, p_trace) != 0)
+        return -1;
+    p_trace->count = (p_trace->length - TRACE_HEADER_BYTES) / TRACE_RECORD_BYTES;
+    return 0;
+}
+
+/**
+ * Subroutine for mapping a compressed trace file into memory, counting the
+ * records from the block headers
+ *
+ * @path The trace file
+ * @p_trace Filled in with the mapping on success
+ */
+int trace_map_compressed(const char* path, mapped_trace_t* p_trace) {
+    if (trace_map_file(path, TRACE_COMPRESSED_MAGIC, p_trace) != 0)
+        return -1;
+    const unsigned char* p = p_trace->records;
+    const unsigned char* end = p_trace->base + p_trace->length;
+    while ((size_t) (end - p) >= TRACE_BLOCK_HEADER_BYTES) {
+        uint32_t count, bytes;
+        memcpy(&count, p, sizeof(count));
+        memcpy(&bytes, p + 4, sizeof(bytes));
+        p += TRACE_BLOCK_HEADER_BYTES;
+        if ((size_t) (end - p) < bytes)
+            break;
+        p_trace->count += count;
+        p += bytes;
+    }
+    return 0;
+}
+
+/**
+ * Subroutine for releasing a mapping made by trace_map
+ *
+ * @p_trace The mapped trace
+ */
+void trace_unmap(mapped_trace_t* p_trace) {
+    if (p_trace->base != NULL)
+        munmap((void*) p_trace->base, p_trace->length);
+    memset(p_trace, 0, sizeof(*p_trace));
+}
+
+/**
+ * Subroutine for parsing a text trace into an anonymous mapping laid out like
+ * a binary trace file, so it can be shared by all readers of mapped traces
+ *
+ * @in The text trace
+ * @p_trace Filled in with the mapping on success
+ */
+static int trace_parse_text(FILE* in, mapped_trace_t* p_trace) {
+    size_t capacity = 1 << 24;
+    unsigned char* base = (unsigned char*) mmap(NULL, capacity, PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return -1;
+    memcpy(base, TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC));
+
+    size_t used = TRACE_HEADER_BYTES;
+    char rw;
+    uint64_t address;
+    while (!feof(in)) {
+        int ret = fscanf(in, "%c %" PRIx64 "\n", &rw, &address);
+        if(ret != 2)
+            continue;
+        if (used + TRACE_RECORD_BYTES > capacity) {
+            //grow geometrically, the kernel may move the mapping
+            void* grown = mremap(base, capacity, 2 * capacity, MREMAP_MAYMOVE);
+            if (grown == MAP_FAILED) {
+                munmap(base, capacity);
+                return -1;
+            }
+            base = (unsigned char*) grown;
+            capacity *= 2;
+        }
+        base[used] = (unsigned char) rw;
+        memcpy(base + used + 1, &address, sizeof(address));
+        used += TRACE_RECORD_BYTES;
+    }
+
+    p_trace->base = base;
+    p_trace->records = base + TRACE_HEADER_BYTES;
+    p_trace->length = capacity;
+    p_trace->count = (used - TRACE_HEADER_BYTES) / TRACE_RECORD_BYTES;
+    return 0;
+}
+
+/**
+ * Subroutine for decoding a compressed trace into an anonymous mapping laid
+ * out like a binary trace file
+ *
+ * @path The compressed trace file
+ * @p_trace Filled in with the mapping on success
+ */
+static int trace_decode_compressed(const char* path, mapped_trace_t* p_trace) {
+    mapped_trace_t compressed;
+    if (trace_map_compressed(path, &compressed) != 0)
+        return -1;
+    size_t length = TRACE_HEADER_BYTES + compressed.count * TRACE_RECORD_BYTES;
+    unsigned char* base = (unsigned char*) mmap(NULL, length, PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    char* types = (char*) malloc(TRACE_BLOCK_RECORDS);
+    uint64_t* addresses = (uint64_t*) malloc(TRACE_BLOCK_RECORDS * sizeof(uint64_t));
+    if (base == MAP_FAILED || types == NULL || addresses == NULL) {
+        if (base != MAP_FAILED)
+            munmap(base, length);
+        free(types);
+        free(addresses);
+        trace_unmap(&compressed);
+        return -1;
+    }
+    memcpy(base, TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC));
+
+    unsigned char* record = base + TRACE_HEADER_BYTES;
+    const unsigned char* p = compressed.records;
+    const unsigned char* end = compressed.base + compressed.length;
+    uint64_t decoded = 0;
+    while (p < end) {
+        uint32_t n = trace_decode_block(p, end, types, addresses, &p);
+        uint32_t i;
+        for (i = 0; i < n && decoded < compressed.count; i++, decoded++) {
+            record[0] = (unsigned char) types[i];
+            memcpy(record + 1, &addresses[i], sizeof(addresses[i]));
+            record += TRACE_RECORD_BYTES;
+        }
+    }
+    free(types);
+    free(addresses);
+    trace_unmap(&compressed);
+
+    p_trace->base = base;
+    p_trace->records = base + TRACE_HEADER_BYTES;
+    p_trace->length = length;
+    p_trace->count = decoded;
+    return 0;
+}
+
+/**
+ * Subroutine for loading a whole trace, text, binary or compressed, into memory
+ *
+ * @path The trace file, stdin if NULL
+ * @p_trace Filled in with the mapping on success
+ */
+int trace_load(const char* path, mapped_trace_t* p_trace) {
+    memset(p_trace, 0, sizeof(*p_trace));
+    if (path != NULL && trace_is_binary(path))
+        return trace_map(path, p_trace);
+    if (path != NULL && trace_is_compressed(path))
+        return trace_decode_compressed(path, p_trace);
+    if (path == NULL)
+        return trace_parse_text(stdin, p_trace);
+
+    FILE* in = fopen(path, "r");
+    if (in == NULL)
+        return -1;
+    int ret = trace_parse_text(in, p_trace);
+    fclose(in);
+    return ret;
+}
+
+/**
+ * Subroutine for starting a binary trace
+ *
+ * @out The output stream
+ */
+int trace_write_header(FILE* out) {
+    return fwrite(TRACE_BINARY_MAGIC, 1, sizeof(TRACE_BINARY_MAGIC), out) == sizeof(TRACE_BINARY_MAGIC) ? 0 : -1;
+}
+
+/**
+ * Subroutine for appending one access to a binary trace
+ *
+ * @out The output stream
+ * @type The type of event, can be READ or WRITE
+ * @address The target memory address
+ */
+int trace_write_record(FILE* out, char type, uint64_t address) {
+    unsigned char record[TRACE_RECORD_BYTES];
+    record[0] = (unsigned char) type;
+    memcpy(record + 1, &address, sizeof(address));
+    return fwrite(record, 1, sizeof(record), out) == sizeof(record) ? 0 : -1;
+}
+
+/**
+ * Subroutine for starting a compressed trace
+ *
+ * @p_writer The writer state
+ * @out The output stream
+ */
+int trace_compressed_open(compressed_writer_t* p_writer, FILE* out) {
+    memset(p_writer, 0, sizeof(*p_writer));
+    p_writer->out = out;
+    p_writer->payload = (unsigned char*) malloc(TRACE_BLOCK_RECORDS * TRACE_VARINT_MAX_BYTES);
+    if (p_writer->payload == NULL)
+        return -1;
+    return fwrite(TRACE_COMPRESSED_MAGIC, 1, sizeof(TRACE_COMPRESSED_MAGIC), out) ==
+           sizeof(TRACE_COMPRESSED_MAGIC) ? 0 : -1;
+}
+
+/**
+ * Writes out the block being filled and starts the next one
+ *
+ * @p_writer The writer state
+ */
+static int trace_compressed_flush(compressed_writer_t* p_writer) {
+    if (p_writer->records == 0)
+        return 0;
+    uint32_t header[2] = { p_writer->records, (uint32_t) p_writer->used };
+    int err = fwrite(header, 1, sizeof(header), p_writer->out) != sizeof(header) ||
+              fwrite(p_writer->payload, 1, p_writer->used, p_writer->out) != p_writer->used;
+    p_writer->used = 0;
+    p_writer->records = 0;
+    memset(p_writer->base, 0, sizeof(p_writer->base));
+    return err ? -1 : 0;
+}
+
+/**
+ * Subroutine for appending one access to a compressed trace
+ *
+ * @p_writer The writer state
+ * @type The type of event, can be READ or WRITE
+ * @address The target memory address
+ */
+int trace_compressed_record(compressed_writer_t* p_writer, char type, uint64_t address) {
+    //delta from the nearest base, the first one on a tie
+    int slot = 0;
+    uint64_t nearest = UINT64_MAX;
+    int j;
+    for (j = 0; j < TRACE_BASE_SLOTS; j++) {
+        uint64_t distance = address >= p_writer->base[j] ? address - p_writer->base[j] : p_writer->base[j] - address;
+        if (distance < nearest) {
+            nearest = distance;
+            slot = j;
+        }
+    }
+    int64_t delta = (int64_t) (address - p_writer->base[slot]);
+    p_writer->base[slot] = address;
+    uint64_t zigzag = ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+    //the varint value is 67 bits wide, low holds bits 0-63 and high bits 64-66
+    uint64_t low = (zigzag << 3) | ((uint64_t) slot << 1) | (type == 'w');
+    uint64_t high = zigzag >> 61;
+    unsigned char* p = p_writer->payload + p_writer->used;
+    while (low >= 0x80 || high) {
+        *p++ = (unsigned char) (low | 0x80);
+        low = (low >> 7) | (high << 57);
+        high = 0;
+    }
+    *p++ = (unsigned char) low;
+    p_writer->used = p - p_writer->payload;
+    p_writer->total++;
+    if (++p_writer->records == TRACE_BLOCK_RECORDS)
+        return trace_compressed_flush(p_writer);
+    return 0;
+}
+
+/**
+ * Subroutine for finishing a compressed trace, the stream stays open
+ *
+ * @p_writer The writer state
+ */
+int trace_compressed_close(compressed_writer_t* p_writer) {
+    int err = trace_compressed_flush(p_writer);
+    free(p_writer->payload);
+    p_writer->payload = NULL;
+    return err;
+}
@@ -0,0 +1,171 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#ifdef CCOMPILER
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#else
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#endif
+
+/*
+ * Binary trace format
+ *
+ * An 8-byte magic string followed by fixed-width 9-byte records: the access
+ * type (READ or WRITE) and the 64-bit address in host byte order (little-endian on x86).
+ * There is no record count in the header, it is derived from the file size
+ * so that the converter can stream into a pipe.
+ */
+static const char     TRACE_BINARY_MAGIC[8] = { 'C', 'S', 'I', 'M', 'B', 'T', '0', '1' };
+static const size_t   TRACE_HEADER_BYTES = 8;
+static const size_t   TRACE_RECORD_BYTES = 9;
+
+/*
+ * Compressed trace format
+ *
+ * An 8-byte magic string followed by blocks of up to TRACE_BLOCK_RECORDS
+ * records. A block starts with its record count and payload size in bytes,
+ * two 32-bit words in host byte order, followed by one LEB128 varint per
+ * record holding zigzag(address - base[slot]) << 3 | slot << 1 | (type == WRITE).
+ * base holds TRACE_BASE_SLOTS recent addresses and the writer picks the
+ * nearest one, which then becomes the address; real traces interleave a few
+ * streams (code, stack, heap) and each tends to keep a slot, so the deltas
+ * stay small. The bases are 0 at the start of every block, so each block
+ * decodes on its own. Types other than WRITE come back as READ.
+ */
+static const char     TRACE_COMPRESSED_MAGIC[8] = { 'C', 'S', 'I', 'M', 'Z', 'T', '0', '1' };
+static const uint32_t TRACE_BLOCK_RECORDS = 65536;
+static const size_t   TRACE_BLOCK_HEADER_BYTES = 8;
+static const int      TRACE_BASE_SLOTS = 4;
+/** A 64-bit zigzag delta plus the slot and type bits takes 67 bits, i.e. 10 varint bytes */
+static const size_t   TRACE_VARINT_MAX_BYTES = 10;
+
+/** A read-only mapping of a binary trace, from a file or parsed into memory */
+struct mapped_trace_t {
+    const unsigned char* base;      /* start of the mapping, i.e. the header */
+    const unsigned char* records;   /* first record */
+    size_t length;                  /* bytes mapped */
+    uint64_t count;                 /* number of complete records */
+};
+
+/** Returns 1 if the file at path starts with the binary trace magic */
+int trace_is_binary(const char* path);
+
+/** Returns 1 if the file at path starts with the compressed trace magic */
+int trace_is_compressed(const char* path);
+
+/** Maps a binary trace file, returns 0 on success and -1 on error */
+int trace_map(const char* path, mapped_trace_t* p_trace);
+void trace_unmap(mapped_trace_t* p_trace);
+
+/**
+ * Loads a whole trace into memory in the binary layout, mapping binary
+ * files, decoding compressed ones and parsing text ones (stdin if path is
+ * NULL). Returns 0 on success
+ * and -1 on error; release with trace_unmap.
+ */
+int trace_load(const char* path, mapped_trace_t* p_trace);
+
+/** Writes the header and a single record of a binary trace */
+int trace_write_header(FILE* out);
+int trace_write_record(FILE* out, char type, uint64_t address);
+
+/** Writes a compressed trace one record at a time, a block at a time */
+struct compressed_writer_t {
+    FILE* out;
+    unsigned char* payload;         /* the varints of the block being filled */
+    size_t used;                    /* bytes of payload */
+    uint32_t records;               /* records in the block */
+    uint64_t base[TRACE_BASE_SLOTS];    /* the delta bases, see the format */
+    uint64_t total;                 /* records written so far */
+};
+
+/**
+ * Writes the header of a compressed trace, then records go through
+ * trace_compressed_record and the last block out with trace_compressed_close,
+ * which does not close out. Each returns 0 on success and -1 on error.
+ */
+int trace_compressed_open(compressed_writer_t* p_writer, FILE* out);
+int trace_compressed_record(compressed_writer_t* p_writer, char type, uint64_t address);
+int trace_compressed_close(compressed_writer_t* p_writer);
+
+/**
+ * Maps a compressed trace file. records points at the first block and count
+ * is the total over all blocks; decode them with trace_decode_block.
+ */
+int trace_map_compressed(const char* path, mapped_trace_t* p_trace);
+
+/**
+ * Decodes the block at p into types and addresses (room for
+ * TRACE_BLOCK_RECORDS each) and returns the number of records; *p_next is
+ * set to the next block. end bounds the mapping, a block running past it
+ * decodes as empty.
+ */
+static inline uint32_t trace_decode_block(const unsigned char* p, const unsigned char* end, char* types,
+                                          uint64_t* addresses, const unsigned char** p_next) {
+    uint32_t count, bytes;
+    if ((size_t) (end - p) < TRACE_BLOCK_HEADER_BYTES) {
+        *p_next = end;
+        return 0;
+    }
+    memcpy(&count, p, sizeof(count));
+    memcpy(&bytes, p + 4, sizeof(bytes));
+    p += TRACE_BLOCK_HEADER_BYTES;
+    if ((size_t) (end - p) < bytes || count > TRACE_BLOCK_RECORDS || count > bytes) {
+        *p_next = end;
+        return 0;
+    }
+    const unsigned char* block_end = p + bytes;
+    *p_next = block_end;
+
+    uint64_t base[TRACE_BASE_SLOTS] = { 0, 0, 0, 0 };
+    uint32_t i;
+    for (i = 0; i < count; i++) {
+        uint64_t value;
+        uint64_t high = 0;
+        if (p == block_end)
+            return i;
+        unsigned char byte = *p++;
+        if (byte < 0x80) {
+            //the common case of a small delta
+            value = byte;
+        } else {
+            value = byte & 0x7f;
+            int shift = 7;
+            do {
+                if (p == block_end)
+                    return i;
+                byte = *p++;
+                value |= (uint64_t) (byte & 0x7f) << shift;
+                shift += 7;
+            } while ((byte & 0x80) && shift < 70);
+            //bits 64-66 of the value, the top of the zigzag delta, are in the tenth byte
+            if (shift == 70)
+                high = (byte >> 1) & 7;
+        }
+        uint64_t zigzag = (value >> 3) | (high << 61);
+        uint64_t* p_base = &base[(value >> 1) & (TRACE_BASE_SLOTS - 1)];
+        *p_base += (zigzag >> 1) ^ (0 - (zigzag & 1));
+        types[i] = (value & 1) ? 'w' : 'r';
+        addresses[i] = *p_base;
+    }
+    return count;
+}
+
+/** Decodes record i of a mapped trace */
+static inline char trace_record_type(const mapped_trace_t* p_trace, uint64_t i) {
+    return (char) p_trace->records[i * TRACE_RECORD_BYTES];
+}
+
+static inline uint64_t trace_record_address(const mapped_trace_t* p_trace, uint64_t i) {
+    uint64_t address;
+    memcpy(&address, p_trace->records + i * TRACE_RECORD_BYTES + 1, sizeof(address));
+    return address;
+}
+
+#endif /* TRACE_HPP */
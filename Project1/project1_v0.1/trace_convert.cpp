@@ -0,0 +1,81 @@
+#ifdef CCOMPILER
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#else
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#endif
+
+#include <unistd.h>
+#include "trace.hpp"
+
+void print_help_and_exit(void) {
+    printf("trace_convert [OPTIONS] < traces/file.trace > file.btrace\n");
+    printf("Converts a text trace into the binary trace format read by cachesim -f\n");
+    printf("-h\t\tThis helpful output\n");
+    printf("-o FILE\t\tWrite the binary trace to FILE instead of stdout\n");
+    printf("-z\t\tWrite the compressed format instead, delta and varint coded\n");
+    printf("\t\tblocks that are typically several times smaller than binary\n");
+    exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    const char* out_path = NULL;
+    bool compressed = false;
+
+    while(-1 != (opt = getopt(argc, argv, "o:zh"))) {
+        switch(opt) {
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'z':
+            compressed = true;
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    FILE* out = stdout;
+    if (out_path != NULL && (out = fopen(out_path, "wb")) == NULL) {
+        fprintf(stderr, "trace_convert: cannot open %s\n", out_path);
+        return 1;
+    }
+
+    /* Large stdio buffers, the converter is streaming both ways */
+    static char in_buffer[1 << 20];
+    static char out_buffer[1 << 20];
+    setvbuf(stdin, in_buffer, _IOFBF, sizeof(in_buffer));
+    setvbuf(out, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    compressed_writer_t writer;
+    int err = compressed ? trace_compressed_open(&writer, out) : trace_write_header(out);
+    char rw;
+    uint64_t address;
+    uint64_t records = 0;
+    while (!err && !feof(stdin)) {
+        int ret = fscanf(stdin, "%c %" PRIx64 "\n", &rw, &address);
+        if(ret == 2) {
+            if (compressed)
+                err = trace_compressed_record(&writer, rw, address);
+            else
+                err = trace_write_record(out, rw, address);
+            records++;
+        }
+    }
+
+    if (compressed && trace_compressed_close(&writer) != 0)
+        err = 1;
+    if (fclose(out) != 0 || err) {
+        fprintf(stderr, "trace_convert: write failed\n");
+        return 1;
+    }
+    fprintf(stderr, "trace_convert: %" PRIu64 " records\n", records);
+    return 0;
+}
@@ -0,0 +1,243 @@
+#ifdef CCOMPILER
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#else
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#endif
+
+#include <unistd.h>
+#include <vector>
+#include "trace.hpp"
+
+/** Access patterns selectable with -p */
+enum pattern_t {
+    PATTERN_SEQ,        /* 8-byte words in address order, wrapping around the footprint */
+    PATTERN_STRIDE,     /* every STRIDE bytes, wrapping around the footprint */
+    PATTERN_RANDOM,     /* uniform 8-byte words of the footprint */
+    PATTERN_ZIPF,       /* blocks of the footprint by Zipf rank, the ranks scattered over it */
+    PATTERN_CHASE       /* one block after another along a random cyclic permutation */
+};
+
+static const char* PATTERN_NAMES[] = { "seq", "stride", "random", "zipf", "chase" };
+
+//granularity of the zipf and chase patterns, a common cache block
+static const uint64_t GEN_BLOCK_BYTES = 64;
+
+void print_help_and_exit(void) {
+    printf("trace_gen [OPTIONS] > file.trace\n");
+    printf("Writes a synthetic trace in the text format read by cachesim, the same\n");
+    printf("options and seed always give the same trace\n");
+    printf("-h\t\tThis helpful output\n");
+    printf("-p PATTERN\tseq (default), stride, random, zipf or chase (pointer chasing\n");
+    printf("\t\tover a random cyclic permutation of the blocks)\n");
+    printf("-n N\t\tNumber of accesses (default 1000000)\n");
+    printf("-m BYTES\tFootprint, i.e. the size of the region accessed (default 1048576)\n");
+    printf("-t BYTES\tStride of the stride pattern (default 64)\n");
+    printf("-z THETA\tSkew of the zipf pattern, 0 < THETA < 1 (default 0.99)\n");
+    printf("-w PERCENT\tPercentage of writes (default 30)\n");
+    printf("-a BASE\t\tFirst address of the region, hex (default 10000000)\n");
+    printf("-s SEED\t\tSeed of the generator (default 1)\n");
+    printf("-B\t\tWrite the binary format read by cachesim -f instead of text\n");
+    printf("-o FILE\t\tWrite the trace to FILE instead of stdout\n");
+    exit(0);
+}
+
+/** splitmix64, small and the same on every platform */
+static uint64_t next_random(uint64_t* p_state) {
+    uint64_t z = (*p_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/** A uniform double in [0, 1) */
+static double next_unit(uint64_t* p_state) {
+    return (next_random(p_state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** A uniform integer in [0, n) */
+static uint64_t next_below(uint64_t* p_state, uint64_t n) {
+    return next_random(p_state) % n;
+}
+
+/*
+ * Zipf ranks in [0, n) with P(rank k) proportional to 1 / (k + 1)^theta, by
+ * the closed-form method of Gray et al. ("Quickly generating billion-record
+ * synthetic databases"): one pass to sum the series, then O(1) per rank.
+ */
+struct zipf_t {
+    uint64_t n;
+    double theta;
+    double alpha;
+    double zeta_n;
+    double eta;
+};
+
+static void zipf_init(zipf_t* z, uint64_t n, double theta) {
+    z->n = n;
+    z->theta = theta;
+    z->zeta_n = 0;
+    uint64_t k;
+    for (k = 1; k <= n; k++)
+        z->zeta_n += 1 / pow((double) k, theta);
+    double zeta_2 = 1 + 1 / pow(2.0, theta);
+    z->alpha = 1 / (1 - theta);
+    z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta_2 / z->zeta_n);
+}
+
+static uint64_t zipf_next(zipf_t* z, uint64_t* p_state) {
+    double u = next_unit(p_state);
+    double uz = u * z->zeta_n;
+    if (uz < 1)
+        return 0;
+    if (uz < 1 + pow(0.5, z->theta))
+        return 1;
+    uint64_t rank = (uint64_t) (z->n * pow(z->eta * u - z->eta + 1, z->alpha));
+    return rank < z->n ? rank : z->n - 1;
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    int pattern = PATTERN_SEQ;
+    uint64_t count = 1000000;
+    uint64_t footprint = 1 << 20;
+    uint64_t stride = 64;
+    double theta = 0.99;
+    int write_percent = 30;
+    uint64_t base = 0x10000000;
+    uint64_t seed = 1;
+    bool binary = false;
+    const char* out_path = NULL;
+
+    while(-1 != (opt = getopt(argc, argv, "p:n:m:t:z:w:a:s:Bo:h"))) {
+        switch(opt) {
+        case 'p':
+            for (pattern = 0; pattern <= PATTERN_CHASE; pattern++) {
+                if (!strcmp(optarg, PATTERN_NAMES[pattern]))
+                    break;
+            }
+            if (pattern > PATTERN_CHASE)
+                print_help_and_exit();
+            break;
+        case 'n':
+            count = strtoull(optarg, NULL, 10);
+            break;
+        case 'm':
+            footprint = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            stride = strtoull(optarg, NULL, 10);
+            break;
+        case 'z':
+            theta = atof(optarg);
+            if (theta <= 0 || theta >= 1)
+                print_help_and_exit();
+            break;
+        case 'w':
+            write_percent = atoi(optarg);
+            if (write_percent < 0 || write_percent > 100)
+                print_help_and_exit();
+            break;
+        case 'a':
+            base = strtoull(optarg, NULL, 16);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'B':
+            binary = true;
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    uint64_t blocks = footprint / GEN_BLOCK_BYTES;
+    if (footprint < 8 || stride == 0 || ((pattern == PATTERN_ZIPF || pattern == PATTERN_CHASE) && blocks < 2)) {
+        fprintf(stderr, "trace_gen: the footprint is too small for the pattern\n");
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (out_path != NULL && (out = fopen(out_path, binary ? "wb" : "w")) == NULL) {
+        fprintf(stderr, "trace_gen: cannot open %s\n", out_path);
+        return 1;
+    }
+    static char out_buffer[1 << 20];
+    setvbuf(out, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    //the type and the address draw from separate streams, so the addresses
+    //of a pattern do not change with the write percentage
+    uint64_t type_state = seed * 2 + 1;
+    uint64_t address_state = seed * 2;
+
+    //zipf ranks and chase steps go through a random permutation of the blocks
+    std::vector<uint64_t> order;
+    zipf_t zipf;
+    memset(&zipf, 0, sizeof(zipf));
+    if (pattern == PATTERN_ZIPF || pattern == PATTERN_CHASE) {
+        order.resize(blocks);
+        uint64_t k;
+        for (k = 0; k < blocks; k++)
+            order[k] = k;
+        //Fisher-Yates for zipf, Sattolo's variant for chase so that the
+        //permutation is a single cycle through every block
+        for (k = blocks - 1; k > 0; k--) {
+            uint64_t j = next_below(&address_state, pattern == PATTERN_CHASE ? k : k + 1);
+            uint64_t t = order[k];
+            order[k] = order[j];
+            order[j] = t;
+        }
+        if (pattern == PATTERN_ZIPF)
+            zipf_init(&zipf, blocks, theta);
+    }
+
+    int err = binary ? trace_write_header(out) : 0;
+    uint64_t block = 0;
+    uint64_t i;
+    for (i = 0; i < count && !err; i++) {
+        uint64_t offset;
+        switch (pattern) {
+        case PATTERN_STRIDE:
+            offset = (i * stride) % footprint;
+            break;
+        case PATTERN_RANDOM:
+            offset = next_below(&address_state, footprint / 8) * 8;
+            break;
+        case PATTERN_ZIPF:
+            offset = order[zipf_next(&zipf, &address_state)] * GEN_BLOCK_BYTES;
+            break;
+        case PATTERN_CHASE:
+            block = order[block];
+            offset = block * GEN_BLOCK_BYTES;
+            break;
+        default:
+            offset = (i * 8) % footprint;
+            break;
+        }
+        char type = next_below(&type_state, 100) < (uint64_t) write_percent ? 'w' : 'r';
+        if (binary)
+            err = trace_write_record(out, type, base + offset);
+        else
+            err = fprintf(out, "%c %" PRIx64 "\n", type, base + offset) < 0;
+    }
+
+    if (fclose(out) != 0 || err) {
+        fprintf(stderr, "trace_gen: write failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "victim_cache.hpp"
+using namespace std;
+
+//miss penalty of memory behind the victim cache
+static const double MEMORY_PENALTY = 20;
+
+/**
+ * Sets up a cold L1 and victim cache
+ *
+ * @c1 The total number of bytes for data storage in L1 is 2^c
+ * @b1 The size of L1's blocks in bytes: 2^b-byte blocks.
+ * @s1 The number of blocks in each set of L1: 2^s blocks per set.
+ * @policy Replacement policy of the L1, the victim cache is LRU
+ * @entries Blocks in the victim cache, a power of two
+ */
+VictimCache::VictimCache(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy, uint64_t entries) {
+	uint64_t entry_bits = __builtin_ctzll(entries);
+	cache = new Cache(c1, b1, s1, policy);
+	victims = new Cache(b1 + entry_bits, b1, entry_bits);
+	S = s1;
+	this->entries = entries;
+	dirty_hits = 0;
+	write_backs = 0;
+}
+
+VictimCache::~VictimCache() {
+	delete cache;
+	delete victims;
+}
+
+/**
+ * Simulates one trace event
+ *
+ * @type The type of event, can be READ or WRITE.
+ * @arg  The target memory address
+ */
+void VictimCache::access(char type, uint64_t arg) {
+	cache_victim_t evicted;
+	bool dirty;
+	if (!cache->access(type, arg, &evicted)) {
+		//the L1 has already brought the block in, from the victim cache if it is there
+		if (victims->extract(arg, &dirty) && dirty) {
+			cache->set_dirty(arg);
+			dirty_hits++;
+		}
+		take_victim(&evicted);
+	}
+
+	//prefetched blocks also come out of the victim cache and their victims
+	//go into it, in the order the L1 filled them
+	const prefetch_fill_t* fills;
+	int n = cache->last_prefetch_fills(&fills);
+	int i;
+	for (i = 0; i < n; i++) {
+		if (victims->invalidate(fills[i].address, &dirty) && dirty)
+			cache->set_dirty(fills[i].address);
+		take_victim(&fills[i].victim);
+	}
+}
+
+/**
+ * Moves a block evicted from the L1 into the victim cache
+ *
+ * @p_evicted The L1 victim, nothing happens if it is not valid
+ */
+void VictimCache::take_victim(const cache_victim_t* p_evicted) {
+	if (!p_evicted->valid)
+		return;
+	cache_victim_t out;
+	victims->insert(p_evicted->address, p_evicted->dirty, &out);
+	if (out.valid && out.dirty)
+		write_backs++;
+}
+
+/**
+ * Calculates the statistics of the L1 and the victim cache
+ *
+ * @p_stats Pointer to the statistics structure
+ */
+void VictimCache::complete(victim_cache_stats_t* p_stats) {
+	cache_stats_t probes;
+	cache->complete(&p_stats->l1);
+	victims->complete(&probes);
+	p_stats->entries = entries;
+	p_stats->probes = probes.accesses;
+	p_stats->hits = probes.total_hits_l1;
+	p_stats->dirty_hits = dirty_hits;
+	p_stats->write_backs = write_backs;
+	p_stats->hit_ratio = probes.accesses ? probes.total_hits_l1 / (double) probes.accesses : 0;
+
+	double HT = 2 + 0.2 * S;
+	double MR = p_stats->l1.accesses ? p_stats->l1.total_misses_l1 / (double) p_stats->l1.accesses : 0;
+	p_stats->avg_access_time = HT + MR * (p_stats->hit_ratio * VICTIM_HIT_TIME +
+	                                         (1 - p_stats->hit_ratio) * MEMORY_PENALTY) +
+	                           p_stats->l1.prefetch_late_cycles / (double) p_stats->l1.accesses;
+}
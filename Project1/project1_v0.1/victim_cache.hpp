@@ -0,0 +1,55 @@
+#ifndef VICTIM_CACHE_HPP
+#define VICTIM_CACHE_HPP
+
+#include "cachesim.hpp"
+
+/**
+ * Cycles to get a block back from the victim cache after an L1 miss. The
+ * probe overlaps the memory request, so a victim miss costs the usual penalty.
+ */
+static const double VICTIM_HIT_TIME = 1;
+
+struct victim_cache_stats_t {
+    cache_stats_t l1;               /* the L1 as usual, write-backs go into the victim cache */
+    uint64_t entries;
+    uint64_t probes;                /* L1 misses looked up in the victim cache */
+    uint64_t hits;                  /* of those, blocks swapped back into the L1 */
+    uint64_t dirty_hits;            /* hits that brought a dirty block back */
+    uint64_t write_backs;           /* dirty blocks evicted from the victim cache to memory */
+    double hit_ratio;               /* hits / probes */
+    double avg_access_time;         /* HT1 + MR1 * (hit_ratio * VICTIM_HIT_TIME + (1 - hit_ratio) * MP) */
+};
+
+/*
+ * An L1 with a small fully associative victim cache behind it. Every block
+ * the L1 evicts, dirty state included, goes into the victim cache. An L1 miss
+ * that hits there swaps the two blocks: the L1 takes the block back and its
+ * own victim takes the freed entry, so a block is never in both. Blocks the
+ * L1's prefetcher brings in leave the victim cache the same way, and their
+ * victims enter it.
+ */
+class VictimCache {
+public:
+    /** entries is a power of two */
+    VictimCache(uint64_t c1, uint64_t b1, uint64_t s1, replacement_t policy, uint64_t entries);
+    ~VictimCache();
+
+    void access(char type, uint64_t arg);
+    void complete(victim_cache_stats_t* p_stats);
+    /** The L1, e.g. to attach a hit/miss log */
+    Cache* l1() { return cache; }
+
+private:
+    VictimCache(const VictimCache&);
+    VictimCache& operator=(const VictimCache&);
+    void take_victim(const cache_victim_t* p_evicted);
+
+    Cache* cache;
+    Cache* victims;                 /* one set of entries ways */
+    uint64_t S;
+    uint64_t entries;
+    uint64_t dirty_hits;
+    uint64_t write_backs;
+};
+
+#endif /* VICTIM_CACHE_HPP */
@@ -0,0 +1,152 @@
+#include "way_search.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WAY_SEARCH_X86 1
+#endif
+
+#ifdef WAY_SEARCH_X86
+
+//AVX2 versions, ways is a power of two >= 4. They are compiled for AVX2 with
+//a target attribute so the rest of the simulator keeps the default ISA.
+
+/**
+ * Valid bits of 32 ways starting at set_state as a bitmask, way i in bit i.
+ * Reads 32 bytes, which is why the state array is padded.
+ */
+__attribute__((target("avx2")))
+static inline uint32_t valid_mask_avx2(const uint8_t* set_state) {
+	__m256i state = _mm256_loadu_si256((const __m256i*) set_state);
+	__m256i valid = _mm256_set1_epi8(BLOCK_VALID);
+	return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(state, valid), valid));
+}
+
+/** Bitmask of the first n ways, n <= 32 */
+static inline uint32_t way_mask(int n) {
+	return n >= 32 ? 0xffffffffu : (1u << n) - 1;
+}
+
+__attribute__((target("avx2")))
+static int find_tag_avx2(const uint64_t* set_tags, const uint8_t* set_state, int ways, uint64_t tag) {
+	__m256i needle = _mm256_set1_epi64x((long long) tag);
+	int chunk;
+	//32 ways at a time: one state load and up to eight 4-way tag compares
+	for (chunk = 0; chunk < ways; chunk += 32) {
+		int n = ways - chunk < 32 ? ways - chunk : 32;
+		uint32_t match = 0;
+		int i;
+		for (i = 0; i < n; i += 4) {
+			__m256i t = _mm256_loadu_si256((const __m256i*) (set_tags + chunk + i));
+			uint32_t m = (uint32_t) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(t, needle)));
+			match |= m << i;
+		}
+		match &= valid_mask_avx2(set_state + chunk) & way_mask(n);
+		if (match)
+			return chunk + __builtin_ctz(match);
+	}
+	return -1;
+}
+
+__attribute__((target("avx2")))
+static int find_empty_avx2(const uint8_t* set_state, int ways) {
+	int chunk;
+	for (chunk = 0; chunk < ways; chunk += 32) {
+		int n = ways - chunk < 32 ? ways - chunk : 32;
+		uint32_t empty = ~valid_mask_avx2(set_state + chunk) & way_mask(n);
+		if (empty)
+			return chunk + __builtin_ctz(empty);
+	}
+	return -1;
+}
+
+__attribute__((target("avx2")))
+static int find_lru_avx2(const uint64_t* set_LRUNum, int ways) {
+	//running minimum and the way it came from, per lane. Stamps are below
+	//2^63 so the signed compare orders them correctly.
+	__m256i best = _mm256_loadu_si256((const __m256i*) set_LRUNum);
+	__m256i best_way = _mm256_setr_epi64x(0, 1, 2, 3);
+	__m256i way = best_way;
+	__m256i step = _mm256_set1_epi64x(4);
+	int i;
+	for (i = 4; i < ways; i += 4) {
+		way = _mm256_add_epi64(way, step);
+		__m256i v = _mm256_loadu_si256((const __m256i*) (set_LRUNum + i));
+		__m256i smaller = _mm256_cmpgt_epi64(best, v);
+		best = _mm256_blendv_epi8(best, v, smaller);
+		best_way = _mm256_blendv_epi8(best_way, way, smaller);
+	}
+
+	//reduce the four lanes, preferring the lower way on a tie
+	uint64_t lane[4], lane_way[4];
+	_mm256_storeu_si256((__m256i*) lane, best);
+	_mm256_storeu_si256((__m256i*) lane_way, best_way);
+	int evict = 0;
+	for (i = 1; i < 4; i++) {
+		if (lane[i] < lane[evict] || (lane[i] == lane[evict] && lane_way[i] < lane_way[evict]))
+			evict = i;
+	}
+	return (int) lane_way[evict];
+}
+
+//SSE2 versions for sets of 4 to 16 ways, where AVX2 does not pay. SSE2 is
+//part of x86-64, so they need no target attribute or CPU check there.
+#ifdef __SSE2__
+
+/**
+ * Valid bits of 16 ways starting at set_state as a bitmask, way i in bit i.
+ * Reads 16 bytes, which the state array padding covers.
+ */
+static inline uint32_t valid_mask_sse2(const uint8_t* set_state) {
+	__m128i state = _mm_loadu_si128((const __m128i*) set_state);
+	__m128i valid = _mm_set1_epi8(BLOCK_VALID);
+	return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(state, valid), valid));
+}
+
+static int find_tag_sse2(const uint64_t* set_tags, const uint8_t* set_state, int ways, uint64_t tag) {
+	__m128i needle = _mm_set1_epi64x((long long) tag);
+	uint32_t match = 0;
+	int i;
+	for (i = 0; i < ways; i += 2) {
+		//SSE2 has no 64-bit compare: both 32-bit halves have to be equal
+		__m128i halves = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (set_tags + i)), needle);
+		__m128i equal = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+		match |= (uint32_t) _mm_movemask_pd(_mm_castsi128_pd(equal)) << i;
+	}
+	match &= valid_mask_sse2(set_state) & way_mask(ways);
+	return match ? __builtin_ctz(match) : -1;
+}
+
+static int find_empty_sse2(const uint8_t* set_state, int ways) {
+	uint32_t empty = ~valid_mask_sse2(set_state) & way_mask(ways);
+	return empty ? __builtin_ctz(empty) : -1;
+}
+#endif /* __SSE2__ */
+
+#endif /* WAY_SEARCH_X86 */
+
+/**
+ * Subroutine for choosing the way search implementation
+ *
+ * @ways The number of blocks in each set
+ */
+way_search_t select_way_search(int ways) {
+	way_search_t search;
+	search.vectorized = false;
+#ifdef WAY_SEARCH_X86
+	if (ways >= WAY_SEARCH_MIN_WAYS && __builtin_cpu_supports("avx2")) {
+		search.vectorized = true;
+		search.find_tag = find_tag_avx2;
+		search.find_empty = find_empty_avx2;
+		search.find_lru = find_lru_avx2;
+	}
+#ifdef __SSE2__
+	else if (ways >= WAY_SEARCH_SSE2_MIN_WAYS && ways <= WAY_SEARCH_SSE2_MAX_WAYS) {
+		search.vectorized = true;
+		search.find_tag = find_tag_sse2;
+		search.find_empty = find_empty_sse2;
+		search.find_lru = find_lru_scalar;
+	}
+#endif
+#endif
+	return search;
+}
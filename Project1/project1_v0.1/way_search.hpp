@@ -0,0 +1,82 @@
+#ifndef WAY_SEARCH_HPP
+#define WAY_SEARCH_HPP
+
+#include <cstdint>
+
+/** Bits of the per-way state word */
+static const uint8_t BLOCK_VALID = 1;
+static const uint8_t BLOCK_DIRTY = 2;
+static const uint8_t BLOCK_PREFETCHED = 4;     /* brought in by a prefetch, not used yet */
+
+/*
+ * Searches over the ways of one set. The arguments point at the first way of
+ * the set in the set-major tag and state arrays of the cache, or in the
+ * stamps the LRU replacement state keeps per set. All functions return the
+ * lowest matching way, or -1 if there is none.
+ *
+ * The scalar versions are inline so small sets pay no call; the vectorized
+ * ones are reached through way_search_t when select_way_search enables them.
+ */
+static inline int find_tag_scalar(const uint64_t* set_tags, const uint8_t* set_state, int ways, uint64_t tag) {
+    int i;
+    for (i = 0; i < ways; i++) {
+        if (set_tags[i] == tag && (set_state[i] & BLOCK_VALID))
+            return i;
+    }
+    return -1;
+}
+
+static inline int find_empty_scalar(const uint8_t* set_state, int ways) {
+    int i;
+    for (i = 0; i < ways; i++) {
+        if (!(set_state[i] & BLOCK_VALID))
+            return i;
+    }
+    return -1;
+}
+
+static inline int find_lru_scalar(const uint64_t* set_LRUNum, int ways) {
+    uint64_t smallest_LRUNum = set_LRUNum[0];
+    int evict_num = 0;
+    int i;
+    for (i = 1; i < ways; i++) {
+        if (set_LRUNum[i] < smallest_LRUNum) {
+            smallest_LRUNum = set_LRUNum[i];
+            evict_num = i;
+        }
+    }
+    return evict_num;
+}
+
+struct way_search_t {
+    /** Use the function pointers below instead of the scalar versions */
+    bool vectorized;
+    /** The valid way holding tag */
+    int (*find_tag)(const uint64_t* set_tags, const uint8_t* set_state, int ways, uint64_t tag);
+    /** The first way without the valid bit set */
+    int (*find_empty)(const uint8_t* set_state, int ways);
+    /** The way with the smallest LRU stamp */
+    int (*find_lru)(const uint64_t* set_LRUNum, int ways);
+};
+
+/** Smallest associativity for which the AVX2 searches beat the scalar loops */
+static const int WAY_SEARCH_MIN_WAYS = 16;
+/**
+ * Associativities for which the SSE2 tag and empty-way searches are used
+ * otherwise; the LRU search stays scalar there, SSE2 has no 64-bit compare
+ */
+static const int WAY_SEARCH_SSE2_MIN_WAYS = 4;
+static const int WAY_SEARCH_SSE2_MAX_WAYS = 16;
+
+/** Bytes the vectorized searches may read past the end of the state array */
+static const int WAY_SEARCH_STATE_PAD = 32;
+
+/**
+ * Picks the fastest implementation this CPU supports for a given
+ * associativity: AVX2 when available and the set has WAY_SEARCH_MIN_WAYS
+ * or more ways, else SSE2 from WAY_SEARCH_SSE2_MIN_WAYS to
+ * WAY_SEARCH_SSE2_MAX_WAYS, else the scalar loops
+ */
+way_search_t select_way_search(int ways);
+
+#endif /* WAY_SEARCH_HPP */
@@ -0,0 +1,122 @@
+#include "write_buffer.hpp"
+#include <cstdlib>
+#include <cstring>
+
+/** Drain interval when -W gives only the number of entries */
+static const int DEFAULT_DRAIN_INTERVAL = 4;
+
+/**
+ * Parses the write hit and write miss policies
+ *
+ * @arg back or through, optionally followed by ,allocate or ,no-allocate
+ * @p_config Set to the policies, the buffer settings are left alone
+ */
+int parse_write_policy(const char* arg, write_config_t* p_config) {
+	size_t hit_len = strcspn(arg, ",");
+	if (hit_len == 4 && !strncmp(arg, "back", 4))
+		p_config->write_through = false;
+	else if (hit_len == 7 && !strncmp(arg, "through", 7))
+		p_config->write_through = true;
+	else
+		return -1;
+	p_config->write_allocate = true;
+	if (arg[hit_len] == ',') {
+		const char* miss = arg + hit_len + 1;
+		if (!strcmp(miss, "no-allocate"))
+			p_config->write_allocate = false;
+		else if (strcmp(miss, "allocate"))
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Parses the size and drain rate of the write-combining buffer
+ *
+ * @arg The number of entries, optionally followed by ,DRAIN accesses per write-out
+ * @p_config Set to the buffer settings, the policies are left alone
+ */
+int parse_write_buffer(const char* arg, write_config_t* p_config) {
+	p_config->buffer_entries = atoi(arg);
+	p_config->drain_interval = DEFAULT_DRAIN_INTERVAL;
+	const char* comma = strchr(arg, ',');
+	if (comma != NULL)
+		p_config->drain_interval = atoi(comma + 1);
+	if (p_config->buffer_entries < 1 || p_config->buffer_entries > WRITE_BUFFER_MAX_ENTRIES ||
+	    p_config->drain_interval < 1)
+		return -1;
+	return 0;
+}
+
+const char* write_policy_name(const write_config_t* p_config) {
+	if (p_config->write_through)
+		return p_config->write_allocate ? "write-through, write-allocate" : "write-through, no-write-allocate";
+	return p_config->write_allocate ? "write-back, write-allocate" : "write-back, no-write-allocate";
+}
+
+/**
+ * Sets up an empty buffer
+ *
+ * @entries Number of blocks the buffer holds
+ * @drain_interval Accesses between two entries being written out
+ */
+WriteBuffer::WriteBuffer(int entries, int drain_interval) {
+	this->entries = entries;
+	this->drain_interval = drain_interval;
+	head = 0;
+	count = 0;
+	last_drain = 0;
+	merges = 0;
+	stalls = 0;
+}
+
+/**
+ * Queues one write to the next level
+ *
+ * @block The block number written
+ * @now The number of accesses so far
+ */
+uint64_t WriteBuffer::write(uint64_t block, uint64_t now) {
+	uint64_t written = 0;
+	//retire the entries whose drain slot has passed; an empty buffer does
+	//not bank drain slots for later
+	if (count == 0) {
+		last_drain = now;
+	} else {
+		uint64_t slots = (now - last_drain) / drain_interval;
+		while (slots > 0 && count > 0) {
+			head = (head + 1) % entries;
+			count--;
+			slots--;
+			written++;
+			last_drain += drain_interval;
+		}
+		if (count == 0)
+			last_drain = now;
+	}
+
+	int i;
+	for (i = 0; i < count; i++) {
+		if (blocks[(head + i) % entries] == block) {
+			merges++;
+			return written;
+		}
+	}
+
+	if (count == entries) {
+		stalls++;
+		head = (head + 1) % entries;
+		count--;
+		written++;
+	}
+	blocks[(head + count) % entries] = block;
+	count++;
+	return written;
+}
+
+uint64_t WriteBuffer::drain() {
+	uint64_t written = count;
+	head = 0;
+	count = 0;
+	return written;
+}
@@ -0,0 +1,55 @@
+#ifndef WRITE_BUFFER_HPP
+#define WRITE_BUFFER_HPP
+
+#include <cstdint>
+
+/** Largest number of write-combining buffer entries */
+static const int WRITE_BUFFER_MAX_ENTRIES = 64;
+
+/** How writes reach the next level, set with -w and -W */
+struct write_config_t {
+    bool write_through;     /* write hits go to the next level instead of setting the dirty bit */
+    bool write_allocate;    /* write misses bring the block in (default) or only go to the next level */
+    int buffer_entries;     /* write-combining buffer size in blocks, 0 for no buffer */
+    int drain_interval;     /* accesses between two buffer entries being written out */
+};
+
+/** Parses HIT[,MISS] as taken by -w: back or through, allocate or no-allocate */
+int parse_write_policy(const char* arg, write_config_t* p_config);
+/** Parses ENTRIES[,DRAIN] as taken by -W, returns 0 on success and -1 on error */
+int parse_write_buffer(const char* arg, write_config_t* p_config);
+/** Describes the write policy, e.g. "write-back, write-allocate" */
+const char* write_policy_name(const write_config_t* p_config);
+
+/*
+ * A write-combining buffer between a cache and the next level. Writes to the
+ * next level are queued by block; a write to a block that is already queued
+ * merges into its entry. The oldest entry is written out every drain_interval
+ * accesses, and a write that finds the buffer full first forces the oldest
+ * entry out (a stall).
+ */
+class WriteBuffer {
+public:
+    WriteBuffer(int entries, int drain_interval);
+
+    /**
+     * Queues a write of block at access count now and returns the number of
+     * entries written to the next level meanwhile
+     */
+    uint64_t write(uint64_t block, uint64_t now);
+    /** Writes out every entry still queued, returns how many there were */
+    uint64_t drain();
+
+    uint64_t merges;            /* writes that found their block queued */
+    uint64_t stalls;            /* writes that found the buffer full */
+
+private:
+    uint64_t blocks[WRITE_BUFFER_MAX_ENTRIES];     /* FIFO ring, oldest at head */
+    int entries;
+    int head;
+    int count;
+    uint64_t drain_interval;
+    uint64_t last_drain;        /* access count the drain clock last advanced at */
+};
+
+#endif /* WRITE_BUFFER_HPP */